@@ -0,0 +1,32 @@
+#include "allocation_counter.h"
+
+#include <cstdlib>
+#include <new>
+
+std::atomic<std::size_t> allocation_count{0};
+
+void* operator new(std::size_t size) {
+    allocation_count++;
+    if (void* p = std::malloc(size == 0 ? 1 : size)) return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept {
+    operator delete(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept {
+    operator delete(p);
+}
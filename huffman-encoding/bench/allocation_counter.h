@@ -0,0 +1,9 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Licznik alokacji na stercie: liczba wywolan globalnego operator new (takze new[]).
+// Zastepcze operatory sa w allocation_counter.cpp, osobnej jednostce kompilacji,
+// zeby kompilator nie laczyl wbudowanych malloc/free z wywolaniami new/delete.
+extern std::atomic<std::size_t> allocation_count;
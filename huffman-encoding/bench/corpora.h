@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Korpusy testowe dla huff_bench. Korpusy syntetyczne sa generowane z ustalonego
+// ziarna, wiec wyniki z roznych wersji programu dotycza tych samych danych.
+// Kazda inna nazwa jest traktowana jako sciezka pliku (np. pliki korpusu Silesia).
+class Corpora {
+public:
+    // Nazwy korpusow syntetycznych w kolejnosci domyslnego przebiegu.
+    static constexpr const char* NAMES[] = {"text", "binary", "random", "skewed"};
+
+    // Zwraca dane korpusu `name` (syntetyczne maja `size` bajtow).
+    static std::vector<std::uint8_t> load(const std::string& name, std::size_t size) {
+        if (name == "text") return text(size);
+        if (name == "binary") return binary(size);
+        if (name == "random") return random(size);
+        if (name == "skewed") return skewed(size);
+
+        std::ifstream in(name, std::ios::binary);
+        if (!in) throw std::runtime_error("Nie mozna otworzyc korpusu: " + name);
+        std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (data.empty()) throw std::runtime_error("Pusty korpus: " + name);
+        return data;
+    }
+
+    // Tekst: slowa ze slownika o rozkladzie zblizonym do Zipfa, interpunkcja i podzial na linie.
+    static std::vector<std::uint8_t> text(std::size_t size) {
+        static const char* const words[] = {
+            "i", "w", "nie", "na", "to", "sie", "z", "ze", "do", "jest", "lorem", "ipsum", "dolor", "sit",
+            "amet", "kod", "drzewo", "bajt", "plik", "dane", "kompresja", "consectetur", "adipiscing",
+            "elit", "sed", "eiusmod", "tempor", "incididunt", "labore", "magna", "aliqua", "Huffman",
+            "algorytm", "kolejka", "priorytet", "wezel", "histogram", "strumien", "dekoder", "tablica"};
+        const std::size_t word_count = sizeof(words) / sizeof(words[0]);
+
+        std::vector<std::uint8_t> data;
+        data.reserve(size);
+        Random rng(0x5EED0001);
+        std::size_t line = 0;
+        while (data.size() < size) {
+            // Minimum z dwoch losowan faworyzuje poczatek slownika.
+            std::size_t a = rng.next() % word_count;
+            std::size_t b = rng.next() % word_count;
+            const char* word = words[a < b ? a : b];
+            for (const char* c = word; *c != '\0'; ++c) data.push_back(static_cast<std::uint8_t>(*c));
+            line += 1 + std::char_traits<char>::length(word);
+            unsigned r = static_cast<unsigned>(rng.next() % 16);
+            if (r == 0) data.push_back('.');
+            if (r == 1) data.push_back(',');
+            if (line > 72) {
+                data.push_back('\n');
+                line = 0;
+            } else {
+                data.push_back(' ');
+            }
+        }
+        data.resize(size);
+        return data;
+    }
+
+    // Dane binarne: rekordy z malymi liczbami little-endian, znacznikami i zerowym dopelnieniem.
+    static std::vector<std::uint8_t> binary(std::size_t size) {
+        std::vector<std::uint8_t> data;
+        data.reserve(size);
+        Random rng(0x5EED0002);
+        std::uint32_t id = 0;
+        while (data.size() < size) {
+            std::uint64_t r = rng.next();
+            put_le(data, id++, 4);
+            put_le(data, r & 0x3FF, 4);
+            put_le(data, (r >> 10) & 0xFFFFFF, 4);
+            data.push_back(static_cast<std::uint8_t>(0xA0 | ((r >> 40) & 0x3)));
+            std::size_t zeros = static_cast<std::size_t>((r >> 42) % 12);
+            data.insert(data.end(), zeros, 0);
+            data.push_back(static_cast<std::uint8_t>(r >> 56));
+        }
+        data.resize(size);
+        return data;
+    }
+
+    // Dane losowe o rozkladzie jednostajnym (nie do skompresowania).
+    static std::vector<std::uint8_t> random(std::size_t size) {
+        std::vector<std::uint8_t> data(size);
+        Random rng(0x5EED0003);
+        for (std::uint8_t& byte : data) byte = static_cast<std::uint8_t>(rng.next() >> 56);
+        return data;
+    }
+
+    // Rozklad silnie skosny: bajt k wystepuje z prawdopodobienstwem 2^-(k+1) (okolo 2 bitow na bajt).
+    static std::vector<std::uint8_t> skewed(std::size_t size) {
+        std::vector<std::uint8_t> data(size);
+        Random rng(0x5EED0004);
+        for (std::uint8_t& byte : data) {
+            // Liczba zer na koncu losowego slowa.
+            std::uint64_t r = rng.next();
+            std::uint8_t zeros = 0;
+            while ((r & 1) == 0 && zeros < 63) {
+                r >>= 1;
+                zeros++;
+            }
+            byte = zeros;
+        }
+        return data;
+    }
+
+private:
+    // Generator xorshift64 (szybki i taki sam na kazdej platformie).
+    class Random {
+    public:
+        explicit Random(std::uint64_t seed) : state(seed) {}
+        std::uint64_t next() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        }
+
+    private:
+        std::uint64_t state;
+    };
+
+    static void put_le(std::vector<std::uint8_t>& out, std::uint64_t value, unsigned bytes) {
+        for (unsigned i = 0; i < bytes; ++i) out.push_back(static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+};
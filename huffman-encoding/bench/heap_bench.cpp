@@ -0,0 +1,201 @@
+#include "priority_queue.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+
+// Porownanie kolejki MinPriorityQueue (kopce 2-, 4- i 8-arne) z std::priority_queue
+// o tym samym elemencie (klucz i indeks), dla kopcow od 256 do `max_size` elementow.
+
+// Mierzy czas wykonania funkcji w sekundach (najlepszy z kilku przebiegow).
+template <typename F>
+double best_time(int repeats, F&& body) {
+    double best = 1e300;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+// Generator xorshift - te same priorytety dla kazdej kolejki.
+static std::uint64_t next_random(std::uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+static std::vector<std::uint64_t> random_priorities(std::size_t count, std::uint64_t seed) {
+    std::vector<std::uint64_t> priorities(count);
+    for (std::uint64_t& priority : priorities) priority = next_random(seed) >> 24;
+    return priorities;
+}
+
+// std::priority_queue z tym samym elementem: klucz i indeks wartosci.
+class StdQueue {
+public:
+    void reserve(std::size_t count) {
+        std::vector<Element> storage;
+        storage.reserve(count);
+        queue = Queue(std::greater<Element>(), std::move(storage));
+    }
+
+    void push(std::uint64_t priority, unsigned int tie, std::uint32_t value) {
+        queue.push({{priority, tie}, value});
+    }
+
+    std::pair<QueueKey, std::uint32_t> pop() {
+        Element top = queue.top();
+        queue.pop();
+        return top;
+    }
+
+    bool isEmpty() const {
+        return queue.empty();
+    }
+
+private:
+    using Element = std::pair<QueueKey, std::uint32_t>;
+    using Queue = std::priority_queue<Element, std::vector<Element>, std::greater<Element>>;
+    Queue queue;
+};
+
+// MinPriorityQueue o `Arity` synach.
+template <std::size_t Arity>
+class HeapQueue {
+public:
+    void reserve(std::size_t count) {
+        queue.clear();
+        queue.reserve(count);
+    }
+
+    void push(std::uint64_t priority, unsigned int tie, std::uint32_t value) {
+        queue.push({priority, tie, value});
+    }
+
+    std::pair<QueueKey, std::uint32_t> pop() {
+        typename MinPriorityQueue<Arity>::Item top = queue.pop();
+        return {top.key(), top.index};
+    }
+
+    bool isEmpty() const {
+        return queue.isEmpty();
+    }
+
+private:
+    MinPriorityQueue<Arity> queue;
+};
+
+// Sprawdza kolejnosc zdejmowania (z komparatorem domyslnym i odwrotnym), zgodnosc
+// indeksow z kluczami i budowe liniowa.
+template <std::size_t Arity>
+static bool check_queue() {
+    using Queue = MinPriorityQueue<Arity>;
+    const std::vector<std::uint64_t> priorities = random_priorities(5000, 7);
+    std::vector<QueueKey> sorted;
+    Queue queue;
+    MinPriorityQueue<Arity, std::greater<QueueKey>> reverse;
+    std::vector<typename Queue::Item> items;
+    for (unsigned int i = 0; i < priorities.size(); ++i) {
+        // Co drugi priorytet sie powtarza - kolejnosc rozstrzyga tie.
+        const std::uint64_t priority = priorities[i / 2];
+        sorted.push_back({priority, i});
+        queue.push({priority, i, i * 3});
+        reverse.push({priority, i, i * 3});
+        items.push_back({priority, i, i * 3});
+        // Przeplatanie push i pop.
+        if (i % 3 == 2) queue.push(queue.pop());
+    }
+    std::sort(sorted.begin(), sorted.end());
+    Queue built = Queue::linear_build(std::move(items));
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        if (queue.top().key() != sorted[i]) return false;
+        typename Queue::Item a = queue.pop();
+        typename Queue::Item b = built.pop();
+        auto c = reverse.pop();
+        if (a.key() != sorted[i] || b.key() != sorted[i] || c.key() != sorted[sorted.size() - 1 - i]
+            || a.index != a.tie * 3 || b.index != b.tie * 3 || c.index != c.tie * 3) {
+            return false;
+        }
+    }
+    return queue.isEmpty() && built.isEmpty() && reverse.isEmpty();
+}
+
+// Ns na element: `count` razy push, potem pop az do pustej kolejki.
+template <typename Queue>
+static double push_pop(const std::vector<std::uint64_t>& priorities, std::size_t count, int repeats,
+                       std::uint64_t& checksum) {
+    Queue queue;
+    double seconds = best_time(repeats, [&]() {
+        queue.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i) queue.push(priorities[i], i, i);
+        while (!queue.isEmpty()) checksum += queue.pop().second;
+    });
+    return seconds * 1e9 / static_cast<double>(count);
+}
+
+// Ns na operacje planisty: kolejka `count` zadan, pop najblizszego i push z pozniejszym terminem.
+template <typename Queue>
+static double hold(const std::vector<std::uint64_t>& priorities, std::size_t count, std::size_t operations,
+                   int repeats, std::uint64_t& checksum) {
+    Queue queue;
+    queue.reserve(count);
+    for (std::uint32_t i = 0; i < count; ++i) queue.push(priorities[i], i, i);
+    std::uint64_t state = 11;
+    double seconds = best_time(repeats, [&]() {
+        for (std::size_t op = 0; op < operations; ++op) {
+            std::pair<QueueKey, std::uint32_t> top = queue.pop();
+            queue.push(top.first.first + (next_random(state) >> 44), top.first.second, top.second);
+            checksum += top.second;
+        }
+    });
+    return seconds * 1e9 / static_cast<double>(operations);
+}
+
+int main(int argc, char* argv[]) {
+    const std::size_t max_size = argc > 1 ? static_cast<std::size_t>(std::atoll(argv[1])) : 10000000;
+    const int repeats = argc > 2 ? std::atoi(argv[2]) : 3;
+    if (max_size < 256 || repeats < 1) {
+        std::fprintf(stderr, "Uzycie: heap_bench [najwiekszy_kopiec >= 256] [powtorzenia]\n");
+        return 1;
+    }
+    if (!check_queue<2>() || !check_queue<4>() || !check_queue<8>()) {
+        std::fprintf(stderr, "MinPriorityQueue: bledna kolejnosc elementow albo wartosci!\n");
+        return 1;
+    }
+
+    std::vector<std::size_t> sizes;
+    for (std::size_t size = 256; size < max_size; size *= 16) sizes.push_back(size);
+    sizes.push_back(max_size);
+    const std::vector<std::uint64_t> priorities = random_priorities(max_size, 3);
+    const std::size_t operations = 1000000;
+    std::uint64_t checksum = 0;
+
+    std::printf("ns na element (push, potem pop)  std::priority_queue  2-arny  4-arny  8-arny\n");
+    for (std::size_t size : sizes) {
+        std::printf("%10zu elementow:             %10.1f %9.1f %7.1f %7.1f\n", size,
+                    push_pop<StdQueue>(priorities, size, repeats, checksum),
+                    push_pop<HeapQueue<2>>(priorities, size, repeats, checksum),
+                    push_pop<HeapQueue<4>>(priorities, size, repeats, checksum),
+                    push_pop<HeapQueue<8>>(priorities, size, repeats, checksum));
+    }
+    std::printf("ns na pop+push (planista)        std::priority_queue  2-arny  4-arny  8-arny\n");
+    for (std::size_t size : sizes) {
+        std::printf("%10zu elementow:             %10.1f %9.1f %7.1f %7.1f\n", size,
+                    hold<StdQueue>(priorities, size, operations, repeats, checksum),
+                    hold<HeapQueue<2>>(priorities, size, operations, repeats, checksum),
+                    hold<HeapQueue<4>>(priorities, size, operations, repeats, checksum),
+                    hold<HeapQueue<8>>(priorities, size, operations, repeats, checksum));
+    }
+    std::printf("(suma kontrolna %llu)\n", static_cast<unsigned long long>(checksum));
+    return 0;
+}
@@ -0,0 +1,928 @@
+#include "adaptive_huffman.h"
+#include "allocation_counter.h"
+#include "file_handler.h"
+#include "huffman_tree.h"
+#include "bit_writer.h"
+#include "byte_counter.h"
+#include "length_limited_codes.h"
+#include "corpora.h"
+#include "pipeline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <map>
+#include <new>
+#include <thread>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Strumien wyjsciowy, ktory tylko zlicza zapisane bajty.
+class CountingBuffer : public std::streambuf {
+public:
+    std::size_t written = 0;
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (ch != traits_type::eof()) written++;
+        return ch;
+    }
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        written += static_cast<std::size_t>(n);
+        return n;
+    }
+};
+
+// Koduje dane bit po bicie (bez naglowka) i zwraca liczbe bitow dopelnienia.
+static std::vector<uint8_t> encode_bitwise(const std::vector<uint8_t>& input, const CodeTable& codes, uint8_t& padding) {
+    std::vector<uint8_t> payload;
+    uint8_t buffer = 0;
+    int bit_count = 0;
+    for (uint8_t byte : input) {
+        const HuffmanCode& code = codes[byte];
+        for (int i = code.length - 1; i >= 0; --i) {
+            buffer = static_cast<uint8_t>((buffer << 1) | ((code.bits >> i) & 1));
+            if (++bit_count == 8) {
+                payload.push_back(buffer);
+                buffer = 0;
+                bit_count = 0;
+            }
+        }
+    }
+    padding = 0;
+    if (bit_count != 0) {
+        padding = static_cast<uint8_t>(8 - bit_count);
+        payload.push_back(static_cast<uint8_t>(buffer << padding));
+    }
+    return payload;
+}
+
+// Koduje dane przez BitWriter do strumienia i zwraca liczbe bitow dopelnienia.
+static uint8_t encode_words(const std::vector<uint8_t>& input, const CodeTable& codes, std::ostream& out) {
+    BitWriter writer(out);
+    for (uint8_t byte : input) {
+        writer.put(codes[byte].bits, codes[byte].length);
+    }
+    return writer.finish();
+}
+
+// Zlicza bajty do mapy (dawna metoda, jako punkt odniesienia).
+static std::map<std::byte, uint32_t> count_with_map(const std::vector<uint8_t>& input) {
+    std::map<std::byte, uint32_t> frequencies;
+    for (uint8_t byte : input) frequencies[static_cast<std::byte>(byte)]++;
+    return frequencies;
+}
+
+// Sprawdza budowe drzewa dla licznikow przekraczajacych 32 bity (syntetyczny
+// histogram - bez potrzeby kompresowania pliku wiekszego niz 4 GiB). Koszt
+// kodowania (suma licznik * dlugosc kodu) musi byc rowny kosztowi optymalnemu,
+// liczonemu niezaleznie jako suma wag wezlow wewnetrznych.
+static bool check_huge_counts() {
+    ByteHistogram histogram{};
+    histogram['a'] = 5ULL << 30;              // 5 GiB jednego bajtu
+    histogram['b'] = (1ULL << 32) - 1;        // suma z 'a' przepelnilaby 32 bity
+    histogram['c'] = 3;
+    histogram['d'] = 200ULL << 30;
+    for (unsigned s = 0x80; s < 0x90; ++s) histogram[s] = 1ULL << (s - 0x80 + 20);
+
+    CodeTable codes = HuffmanTree::from_frequencies(histogram).build_huffman_codes();
+
+    std::vector<uint64_t> weights;
+    for (uint64_t count : histogram) if (count != 0) weights.push_back(count);
+    uint64_t optimal = 0;
+    while (weights.size() > 1) {
+        std::sort(weights.begin(), weights.end(), std::greater<uint64_t>());
+        uint64_t merged = weights[weights.size() - 1] + weights[weights.size() - 2];
+        weights.resize(weights.size() - 2);
+        weights.push_back(merged);
+        optimal += merged;
+    }
+
+    uint64_t cost = 0;
+    double kraft = 0.0;
+    for (unsigned s = 0; s < 256; ++s) {
+        if (histogram[s] == 0) continue;
+        if (codes[s].length == 0) return false;
+        cost += histogram[s] * codes[s].length;
+        kraft += std::ldexp(1.0, -codes[s].length);
+    }
+    return cost == optimal && kraft == 1.0 && codes['d'].length == 1;
+}
+
+// Sprawdza HuffCodec dla `streams` strumieni (albo modelu rzedu 1 przy `order1`): dane
+// wracaja bez zmian, wynik miesci sie w compress_bound, a powtorne wywolania z tym
+// samym kontekstem nie alokuja pamieci.
+static bool check_codec(const std::vector<uint8_t>& input, unsigned streams, bool order1) {
+    CodecOptions options;
+    options.streams = streams;
+    options.order1 = order1;
+    HuffContext context;
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> unpacked;
+    HuffCodec::compress(context, input.data(), input.size(), packed, options);
+    HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+    if (unpacked != input || packed.size() > HuffCodec::compress_bound(input.size(), options)) return false;
+
+    std::size_t allocations_before = allocation_count;
+    HuffCodec::compress(context, input.data(), input.size(), packed, options);
+    HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+    return allocation_count == allocations_before && unpacked == input;
+}
+
+// Sprawdza CRC-32C: wartosc wzorcowa, liczenie fragmentami i zgodnosc instrukcji crc32
+// z tablicami slice-by-8, a dla kontenera z sumami kontrolnymi - ze dane wracaja bez
+// zmian i ze zmiana bitu danych bloku jest wykrywana.
+static bool check_checksum(const std::vector<uint8_t>& input) {
+    const uint8_t digits[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+    if (Crc32c::compute(digits, sizeof(digits)) != 0xE3069283u) return false;
+    const std::size_t size = std::min<std::size_t>(input.size(), 4096);
+    for (std::size_t offset = 0; offset < 8 && offset < size; ++offset) {
+        const uint32_t whole = Crc32c::compute(input.data() + offset, size - offset);
+        const std::size_t half = (size - offset) / 2;
+        if (Crc32c::update(Crc32c::compute(input.data() + offset, half), input.data() + offset + half, size - offset - half) != whole
+            || Crc32c::update_portable(0, input.data() + offset, size - offset) != whole) {
+            return false;
+        }
+    }
+
+    CodecOptions options;
+    options.checksum = true;
+    HuffContext context;
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> unpacked;
+    HuffCodec::compress(context, input.data(), input.size(), packed, options);
+    HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+    if (unpacked != input) return false;
+    // Zmiana bitu w srodku pliku (dane albo naglowek bloku).
+    packed[packed.size() / 2] ^= 1;
+    try {
+        HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+// Sprawdza zapis blokow bez kodowania: dane nie do skompresowania (dla modelu rzedu 0
+// i 1) wracaja bez zmian i rosna najwyzej o naglowki blokow.
+static bool check_stored_blocks(const std::vector<uint8_t>& noise) {
+    const std::size_t blocks = (noise.size() + CodecOptions::DEFAULT_BLOCK_SIZE - 1) / CodecOptions::DEFAULT_BLOCK_SIZE;
+    for (bool order1 : {false, true}) {
+        CodecOptions options;
+        options.order1 = order1;
+        HuffContext context;
+        std::vector<uint8_t> packed;
+        std::vector<uint8_t> unpacked;
+        HuffCodec::compress(context, noise.data(), noise.size(), packed, options);
+        HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+        if (unpacked != noise || packed.size() > noise.size() + 16 * (blocks + 1)) return false;
+    }
+    return true;
+}
+
+// Sprawdza histogram z probki: bajty spoza probki (rzadkie albo tylko w jednej czesci
+// bloku) dostaja kody i wracaja bez zmian, a dane, dla ktorych probka jest bledna, sa
+// zapisywane bez kodowania, wiec wynik nie rosnie ponad naglowki blokow.
+static bool check_sampled(const std::vector<uint8_t>& input, const std::vector<uint8_t>& noise) {
+    CodecOptions options;
+    options.sample = CodecOptions::DEFAULT_SAMPLE;
+    HuffContext context;
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> unpacked;
+    // Odcinek tuz za probka (offset SAMPLE_CHUNK) nie jest liczony.
+    std::vector<uint8_t> rare(input);
+    for (size_t offset = CodecOptions::SAMPLE_CHUNK; offset < rare.size(); offset += 997) rare[offset] = 0xFF;
+    HuffCodec::compress(context, rare.data(), rare.size(), packed, options);
+    HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+    if (unpacked != rare || packed.size() > HuffCodec::compress_bound(rare.size(), options)) return false;
+
+    // Probka z samych zer, a reszta bloku to szum - strumienie nie mieszcza sie
+    // w buforach o rozmiarze danych, wiec bloki sa zapisywane bez kodowania.
+    std::vector<uint8_t> mixed(noise);
+    const size_t stride = CodecOptions::SAMPLE_CHUNK * options.sample;
+    for (size_t offset = 0; offset < mixed.size(); offset += stride) {
+        std::fill(mixed.begin() + offset, mixed.begin() + std::min(mixed.size(), offset + CodecOptions::SAMPLE_CHUNK), 0);
+    }
+    const size_t blocks = (mixed.size() + options.block_size - 1) / options.block_size;
+    for (unsigned streams : {1u, 4u}) {
+        options.streams = streams;
+        HuffCodec::compress(context, mixed.data(), mixed.size(), packed, options);
+        HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+        if (unpacked != mixed || packed.size() > mixed.size() + 16 * (blocks + 1)) return false;
+    }
+    return true;
+}
+
+// Sprawdza potok odczyt-kodowanie-zapis: bloki sa zapisywane w kolejnosci odczytu
+// dla roznych liczb buforow i koderow, a wyjatek z etapu kodowania trafia do wywolujacego.
+static bool check_pipeline() {
+    struct Job {
+        uint32_t index = 0;
+        uint64_t value = 0;
+    };
+    for (unsigned buffers : {1u, 2u, 4u}) {
+        for (unsigned coders : {1u, 3u}) {
+            uint32_t next = 0;
+            uint32_t written = 0;
+            bool ordered = true;
+            Pipeline::run<Job>(buffers, coders,
+                [&](Job& job) { job.index = next; return next++ < 1000; },
+                [](Job& job) { job.value = uint64_t{job.index} * job.index; },
+                [&](Job& job) { ordered = ordered && job.index == written && job.value == uint64_t{written} * written; ++written; },
+                nullptr);
+            if (!ordered || written != 1000) return false;
+        }
+    }
+    uint32_t next = 0;
+    try {
+        Pipeline::run<Job>(4, 2, [&](Job& job) { job.index = next; return next++ < 1000; },
+                           [](Job& job) { if (job.index == 500) throw std::runtime_error("blad"); },
+                           [](Job&) {}, nullptr);
+    } catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+// Przepustowosc kompresji blokow po 1 MiB (MB/s), gdy odczyt kazdego bloku czeka `delay`
+// (dysk sieciowy): kolejno w jednym watku albo potokiem. Dane sa powtarzane do co
+// najmniej 16 MiB, zeby start watkow nie przeslanial wyniku. Zwraca {kolejno, potok}.
+static std::pair<double, double> bench_pipeline(const std::vector<uint8_t>& input, std::chrono::microseconds delay) {
+    struct Job {
+        const uint8_t* data = nullptr;
+        std::size_t size = 0;
+        HuffContext context;
+        std::vector<uint8_t> packed;
+    };
+    const std::size_t block = 1 << 20;
+    const std::size_t total = std::max<std::size_t>(input.size(), 16 * block);
+    std::size_t offset = 0;
+    std::size_t written = 0;
+    auto read = [&](Job& job) {
+        if (offset >= total || input.empty()) return false;
+        std::this_thread::sleep_for(delay);
+        const std::size_t position = offset % input.size();
+        job.data = input.data() + position;
+        job.size = std::min({block, input.size() - position, total - offset});
+        offset += job.size;
+        return true;
+    };
+    auto process = [](Job& job) { HuffCodec::compress(job.context, job.data, job.size, job.packed); };
+    auto write = [&](Job& job) { written += job.packed.size(); };
+
+    auto start = std::chrono::steady_clock::now();
+    Job job;
+    while (read(job)) {
+        process(job);
+        write(job);
+    }
+    double sequential = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    offset = 0;
+    start = std::chrono::steady_clock::now();
+    Pipeline::run<Job>(Pipeline::DEFAULT_BUFFERS, 1, read, process, write, nullptr);
+    double pipelined = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double megabytes = total / 1e6;
+    return {megabytes / sequential, megabytes / pipelined};
+}
+
+// Sprawdza wspolna tablice kodow: dane (takze spoza probki) wracaja bez zmian, wynik
+// miesci sie w compress_bound, tablica po zapisie i odczycie ma ten sam identyfikator,
+// a kompresja i dekompresja do podanej pamieci nie alokuja.
+static bool check_shared_table(const std::vector<uint8_t>& sample, const std::vector<uint8_t>& input) {
+    ByteHistogram histogram{};
+    ByteCounter::count(sample.data(), sample.size(), histogram);
+    SharedTable table = SharedTable::train(histogram);
+    const std::string path = "huff_bench_table.huft";
+    table.save(path);
+    bool same = SharedTable::load(path).id() == table.id();
+    std::remove(path.c_str());
+
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> unpacked;
+    HuffCodec::compress(table, input.data(), input.size(), packed);
+    HuffCodec::decompress(table, packed.data(), packed.size(), unpacked);
+    if (!same || unpacked != input || packed.size() > HuffCodec::compress_bound(input.size(), table)) return false;
+
+    std::size_t allocations_before = allocation_count;
+    size_t packed_size = HuffCodec::compress(table, input.data(), input.size(), packed.data(), packed.size());
+    HuffCodec::decompress(table, packed.data(), packed_size, unpacked.data(), unpacked.size());
+    return allocation_count == allocations_before && unpacked == input;
+}
+
+// Mierzy czas wykonania funkcji w sekundach (najlepszy z kilku przebiegow).
+template <typename F>
+double best_time(int repeats, F&& body) {
+    double best = 1e300;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed.count() < best) best = elapsed.count();
+    }
+    return best;
+}
+
+// Wynik pomiaru jednego etapu na jednym korpusie.
+struct StageResult {
+    std::string corpus;
+    std::string stage;
+    // Bajty danych na wywolanie; 0 dla etapow, ktorych czas nie zalezy od danych
+    // (wynik tylko w us na wywolanie, bez MB/s i ns na symbol).
+    std::size_t bytes = 0;
+    // Najlepszy czas jednego wywolania etapu w sekundach.
+    double seconds = 0.0;
+    // Liczba alokacji na jedno wywolanie.
+    double allocations = 0.0;
+    // Rozmiar wyniku wzgledem danych dla etapow calej kompresji (0 - nie dotyczy).
+    double ratio = 0.0;
+};
+
+// Mierzy etap `body` (wywolywany `calls` razy w kazdym z `repeats` przebiegow)
+// i dopisuje wynik w przeliczeniu na jedno wywolanie.
+template <typename F>
+void measure_stage(std::vector<StageResult>& results, const std::string& corpus, const char* stage,
+                   std::size_t bytes, int repeats, int calls, F&& body) {
+    body();
+    std::size_t allocations_before = allocation_count;
+    double seconds = best_time(repeats, [&]() {
+        for (int i = 0; i < calls; ++i) body();
+    });
+    std::size_t allocations = allocation_count - allocations_before;
+    StageResult result;
+    result.corpus = corpus;
+    result.stage = stage;
+    result.bytes = bytes;
+    result.seconds = seconds / calls;
+    result.allocations = static_cast<double>(allocations) / (static_cast<double>(repeats) * calls);
+    results.push_back(result);
+}
+
+// Porownuje kompresje malych rekordow (RECORD_SIZE bajtow, kazdy osobno): kontener
+// blokowy z histogramem i tablica kodow w kazdym rekordzie oraz wspolna tablice kodow
+// wyuczona na pierwszej polowie korpusu (bez zliczania i bez tablicy w wyniku).
+static bool bench_records(const std::string& corpus, const std::vector<uint8_t>& input, int repeats,
+                          std::vector<StageResult>& results) {
+    const size_t RECORD_SIZE = 256;
+    const size_t records = input.size() / RECORD_SIZE;
+    const size_t size = records * RECORD_SIZE;
+    if (records == 0) return true;
+    const double plain = static_cast<double>(size);
+
+    HuffContext context;
+    std::vector<uint8_t> packed;
+    size_t total = 0;
+    measure_stage(results, corpus, "record_static_compress", size, repeats, 1, [&]() {
+        total = 0;
+        for (size_t r = 0; r < records; ++r) {
+            HuffCodec::compress(context, input.data() + r * RECORD_SIZE, RECORD_SIZE, packed);
+            total += packed.size();
+        }
+    });
+    results.back().ratio = static_cast<double>(total) / plain;
+
+    ByteHistogram sample{};
+    ByteCounter::count(input.data(), input.size() / 2, sample);
+    const SharedTable table = SharedTable::train(sample);
+    const size_t bound = HuffCodec::compress_bound(RECORD_SIZE, table);
+    std::vector<uint8_t> shared(records * bound);
+    std::vector<size_t> sizes(records);
+    measure_stage(results, corpus, "record_table_compress", size, repeats, 1, [&]() {
+        for (size_t r = 0; r < records; ++r) {
+            sizes[r] = HuffCodec::compress(table, input.data() + r * RECORD_SIZE, RECORD_SIZE,
+                                           shared.data() + r * bound, bound);
+        }
+    });
+    total = 0;
+    for (size_t packed_size : sizes) total += packed_size;
+    results.back().ratio = static_cast<double>(total) / plain;
+
+    std::vector<uint8_t> unpacked(size);
+    measure_stage(results, corpus, "record_table_decompress", size, repeats, 1, [&]() {
+        for (size_t r = 0; r < records; ++r) {
+            HuffCodec::decompress(table, shared.data() + r * bound, sizes[r], unpacked.data() + r * RECORD_SIZE,
+                                  RECORD_SIZE);
+        }
+    });
+    results.back().ratio = static_cast<double>(total) / plain;
+    return std::equal(unpacked.begin(), unpacked.end(), input.begin());
+}
+
+// Porownuje cala kompresje i dekompresje w pamieci: kontener blokowy (dwa przebiegi
+// i tablica kodow na blok, takze z modelem rzedu 1) z adaptacyjnym kodem Huffmana
+// (jeden przebieg, bez naglowka).
+static bool bench_codecs(const std::string& corpus, const std::vector<uint8_t>& input, int repeats,
+                                     std::vector<StageResult>& results) {
+    const size_t size = input.size();
+    const double plain = static_cast<double>(size);
+
+    HuffContext context;
+    std::vector<uint8_t> packed;
+    measure_stage(results, corpus, "static_compress", size, repeats, 1, [&]() {
+        HuffCodec::compress(context, input.data(), size, packed);
+    });
+    results.back().ratio = static_cast<double>(packed.size()) / plain;
+    std::vector<uint8_t> unpacked(size);
+    measure_stage(results, corpus, "static_decompress", size, repeats, 1, [&]() {
+        HuffCodec::decompress(context, packed.data(), packed.size(), unpacked.data(), unpacked.size());
+    });
+    results.back().ratio = static_cast<double>(packed.size()) / plain;
+    if (unpacked != input) return false;
+
+    CodecOptions checksum;
+    checksum.checksum = true;
+    measure_stage(results, corpus, "checksum_compress", size, repeats, 1, [&]() {
+        HuffCodec::compress(context, input.data(), size, packed, checksum);
+    });
+    results.back().ratio = static_cast<double>(packed.size()) / plain;
+    measure_stage(results, corpus, "checksum_decompress", size, repeats, 1, [&]() {
+        HuffCodec::decompress(context, packed.data(), packed.size(), unpacked.data(), unpacked.size());
+    });
+    results.back().ratio = static_cast<double>(packed.size()) / plain;
+    if (unpacked != input) return false;
+
+    CodecOptions sampled;
+    sampled.sample = CodecOptions::DEFAULT_SAMPLE;
+    measure_stage(results, corpus, "sampled_compress", size, repeats, 1, [&]() {
+        HuffCodec::compress(context, input.data(), size, packed, sampled);
+    });
+    results.back().ratio = static_cast<double>(packed.size()) / plain;
+    HuffCodec::decompress(context, packed.data(), packed.size(), unpacked.data(), unpacked.size());
+    if (unpacked != input) return false;
+
+    CodecOptions order1;
+    order1.order1 = true;
+    measure_stage(results, corpus, "order1_compress", size, repeats, 1, [&]() {
+        HuffCodec::compress(context, input.data(), size, packed, order1);
+    });
+    results.back().ratio = static_cast<double>(packed.size()) / plain;
+    measure_stage(results, corpus, "order1_decompress", size, repeats, 1, [&]() {
+        HuffCodec::decompress(context, packed.data(), packed.size(), unpacked.data(), unpacked.size());
+    });
+    results.back().ratio = static_cast<double>(packed.size()) / plain;
+    if (unpacked != input) return false;
+    if (!bench_records(corpus, input, repeats, results)) return false;
+
+    // Wynik ma rozmiar pliku .huff: dane adaptacyjne i sygnatura z wersja.
+    const double signature = sizeof(HuffFormat::MAGIC) + 1;
+    packed.reserve(size + size / 8 + 64);
+    measure_stage(results, corpus, "adaptive_compress", size, repeats, 1, [&]() {
+        packed.clear();
+        AdaptiveHuffman::compress(input.data(), size, packed);
+    });
+    results.back().ratio = (static_cast<double>(packed.size()) + signature) / plain;
+    unpacked.reserve(size);
+    measure_stage(results, corpus, "adaptive_decompress", size, repeats, 1, [&]() {
+        unpacked.clear();
+        AdaptiveHuffman::decompress(packed.data(), packed.size(), unpacked);
+    });
+    results.back().ratio = (static_cast<double>(packed.size()) + signature) / plain;
+    return unpacked == input;
+}
+
+// Mierzy osobno kolejne etapy kompresji i dekompresji na jednym korpusie.
+static bool bench_stages(const std::string& corpus, const std::vector<uint8_t>& input, int repeats,
+                         std::vector<StageResult>& results) {
+    const size_t size = input.size();
+    volatile uint64_t sink = 0;
+
+    ByteHistogram histogram{};
+    measure_stage(results, corpus, "count_bytes", size, repeats, 1, [&]() {
+        histogram.fill(0);
+        ByteCounter::count(input.data(), size, histogram);
+        sink = sink + histogram[input[0]];
+    });
+
+    // Histogram z probki (--sample): co osmy odcinek bloku po 1 MiB.
+    measure_stage(results, corpus, "sample_histogram", size, repeats, 1, [&]() {
+        for (size_t offset = 0; offset < size; offset += CodecOptions::DEFAULT_BLOCK_SIZE) {
+            histogram.fill(0);
+            HuffCodec::sample_histogram(input.data() + offset, std::min(CodecOptions::DEFAULT_BLOCK_SIZE, size - offset),
+                                        CodecOptions::DEFAULT_SAMPLE, histogram);
+        }
+        sink = sink + histogram[input[0]];
+    });
+    histogram.fill(0);
+    ByteCounter::count(input.data(), size, histogram);
+
+    // Suma kontrolna blokow (--checksum): wersja wybrana dla procesora i tablice slice-by-8.
+    measure_stage(results, corpus, "crc32c", size, repeats, 1, [&]() {
+        sink = sink + Crc32c::compute(input.data(), size);
+    });
+    measure_stage(results, corpus, "crc32c_portable", size, repeats, 1, [&]() {
+        sink = sink + Crc32c::update_portable(0, input.data(), size);
+    });
+
+    // Budowa drzewa i kodow nie zalezy od rozmiaru danych - jedno wywolanie trwa mikrosekundy,
+    // wiec etapy sa podawane tylko jako czas wywolania (bytes = 0).
+    const int tree_calls = 1000;
+    HuffmanTree tree = HuffmanTree::from_frequencies(histogram);
+    measure_stage(results, corpus, "from_frequencies", 0, repeats, tree_calls, [&]() {
+        tree = HuffmanTree::from_frequencies(histogram);
+    });
+    CodeTable codes{};
+    measure_stage(results, corpus, "build_huffman_codes", 0, repeats, tree_calls, [&]() {
+        codes = tree.build_huffman_codes();
+        sink = sink + codes[input[0]].length;
+    });
+
+    const uint64_t bits = LengthLimitedCodes::encoded_bits(histogram, CanonicalCodes::lengths_of(codes));
+    std::vector<uint8_t> payload(static_cast<size_t>((bits + 7) / 8));
+    uint8_t padding = 0;
+    measure_stage(results, corpus, "write_bits", size, repeats, 1, [&]() {
+        BitWriter writer(payload.data(), payload.size());
+        padding = HuffCodec::write_bits(input.data(), size, codes, writer);
+    });
+
+    CountingBuffer decoded;
+    std::ostream decoded_out(&decoded);
+    measure_stage(results, corpus, "decode_payload_to_stream", size, repeats, 1, [&]() {
+        tree.decode_payload_to_stream(payload, padding, decoded_out);
+    });
+
+    std::ostringstream check;
+    tree.decode_payload_to_stream(payload, padding, check);
+    if (check.str() != std::string(input.begin(), input.end())) return false;
+    return bench_codecs(corpus, input, repeats, results);
+}
+
+// Zamienia napis na literal JSON.
+static std::string json_string(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        if (c == '"' || c == '\\') quoted += '\\';
+        if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            quoted += escaped;
+            continue;
+        }
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+// Wypisuje wyniki etapow jako tabele, CSV albo JSON. Etapy bez bajtow danych (bytes = 0)
+// maja tylko czas wywolania: w CSV puste pola, a w JSON null zamiast MB/s i ns na symbol.
+static void print_stages(const std::vector<StageResult>& results, const std::string& format, int repeats) {
+    if (format == "csv") {
+        std::printf("corpus,stage,bytes,seconds,us_per_call,mb_per_s,ns_per_symbol,allocations,ratio\n");
+    } else if (format == "json") {
+        std::printf("{\"benchmark\": \"huff_bench\", \"format_version\": 3, \"repeats\": %d, \"results\": [", repeats);
+    }
+    for (size_t i = 0; i < results.size(); ++i) {
+        const StageResult& r = results[i];
+        const bool per_byte = r.bytes != 0;
+        double megabytes = static_cast<double>(r.bytes) / (1024.0 * 1024.0);
+        double mb_per_s = r.seconds > 0.0 ? megabytes / r.seconds : 0.0;
+        double ns_per_symbol = per_byte ? r.seconds * 1e9 / static_cast<double>(r.bytes) : 0.0;
+        double us_per_call = r.seconds * 1e6;
+        if (format == "csv") {
+            std::printf("%s,%s,%zu,%.9g,%.6g,", r.corpus.c_str(), r.stage.c_str(), r.bytes, r.seconds, us_per_call);
+            if (per_byte) std::printf("%.6g,%.6g", mb_per_s, ns_per_symbol);
+            else std::printf(",");
+            std::printf(",%.6g,", r.allocations);
+            if (r.ratio > 0.0) std::printf("%.6f", r.ratio);
+            std::printf("\n");
+        } else if (format == "json") {
+            std::printf("%s\n  {\"corpus\": %s, \"stage\": \"%s\", \"bytes\": %zu, \"seconds\": %.9g, \"us_per_call\": %.6g, ",
+                        i == 0 ? "" : ",", json_string(r.corpus).c_str(), r.stage.c_str(), r.bytes, r.seconds,
+                        us_per_call);
+            if (per_byte) {
+                std::printf("\"mb_per_s\": %.6g, \"ns_per_symbol\": %.6g, ", mb_per_s, ns_per_symbol);
+            } else {
+                std::printf("\"mb_per_s\": null, \"ns_per_symbol\": null, ");
+            }
+            std::printf("\"allocations\": %.6g, ", r.allocations);
+            if (r.ratio > 0.0) {
+                std::printf("\"ratio\": %.6f}", r.ratio);
+            } else {
+                std::printf("\"ratio\": null}");
+            }
+        } else {
+            if (i == 0 || results[i - 1].corpus != r.corpus) {
+                std::printf("%s (%.2f MB)\n", r.corpus.c_str(), megabytes);
+            }
+            if (per_byte) {
+                std::printf("  %-26s %12.1f MB/s %10.4f ns/symbol %8.1f alokacji", r.stage.c_str(), mb_per_s,
+                            ns_per_symbol, r.allocations);
+            } else {
+                std::printf("  %-26s %12.2f us/wywolanie %12s %8.1f alokacji", r.stage.c_str(), us_per_call, "",
+                            r.allocations);
+            }
+            if (r.ratio > 0.0) std::printf(" %8.2f%% rozmiaru", 100.0 * r.ratio);
+            std::printf("\n");
+        }
+    }
+    if (format == "json") std::printf("\n]}\n");
+}
+
+// Testy poprawnosci bez pomiarow czasu dla danych `input`; dane losowe sprawdzaja
+// compress_bound i bloki bez kodowania dla danych nie do skompresowania. Bledy sa
+// wypisywane na stderr.
+static bool run_self_checks(const std::vector<uint8_t>& input) {
+    if (!check_huge_counts()) {
+        std::fprintf(stderr, "Niepoprawne drzewo dla licznikow powyzej 32 bitow!\n");
+        return false;
+    }
+    std::vector<uint8_t> noise(3 * CodecOptions::DEFAULT_BLOCK_SIZE / 2);
+    std::uint64_t state = 88172645463325252ull;
+    for (uint8_t& byte : noise) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        byte = static_cast<uint8_t>(state);
+    }
+    for (unsigned streams : {1u, 4u}) {
+        if (!check_codec(input, streams, false) || !check_codec(noise, streams, false)) {
+            std::fprintf(stderr, "HuffCodec (%u strumieni): blad danych, rozmiaru lub alokacja pamieci!\n", streams);
+            return false;
+        }
+    }
+    // Model rzedu 1 (tylko jeden strumien).
+    if (!check_codec(input, 1, true) || !check_codec(noise, 1, true)) {
+        std::fprintf(stderr, "HuffCodec (rzad 1): blad danych, rozmiaru lub alokacja pamieci!\n");
+        return false;
+    }
+    if (!check_checksum(input)) {
+        std::fprintf(stderr, "CRC-32C: bledna suma kontrolna albo niewykryte uszkodzenie danych!\n");
+        return false;
+    }
+    if (!check_stored_blocks(noise)) {
+        std::fprintf(stderr, "Bloki bez kodowania: blad danych lub rozmiaru dla danych losowych!\n");
+        return false;
+    }
+    if (!check_sampled(input, noise)) {
+        std::fprintf(stderr, "Histogram z probki: brak kodu dla bajtu spoza probki albo wynik wiekszy niz dane!\n");
+        return false;
+    }
+    if (!check_pipeline()) {
+        std::fprintf(stderr, "Potok odczyt-kodowanie-zapis: bledna kolejnosc blokow albo zgubiony wyjatek!\n");
+        return false;
+    }
+    if (!check_shared_table(input, input) || !check_shared_table(input, noise)) {
+        std::fprintf(stderr, "Wspolna tablica kodow: blad danych, rozmiaru lub alokacja pamieci!\n");
+        return false;
+    }
+    return true;
+}
+
+// Tryb --selftest (cel ctest huff_selftest): testy poprawnosci na korpusach syntetycznych,
+// bez pliku wejsciowego i bez pomiarow. Opcja --size=<MiB> zmienia rozmiar korpusow.
+static int run_selftest(int argc, char* argv[]) {
+    size_t size = 3 * 1024 * 1024;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--size=", 7) == 0) {
+            size = static_cast<size_t>(std::atof(argv[i] + 7) * 1024.0 * 1024.0);
+        } else {
+            std::fprintf(stderr, "Uzycie: huff_bench --selftest [--size=MiB]\n");
+            return 1;
+        }
+    }
+    for (const char* corpus : Corpora::NAMES) {
+        if (!run_self_checks(Corpora::load(corpus, size))) {
+            std::fprintf(stderr, "%s: test nie przeszedl\n", corpus);
+            return 1;
+        }
+        std::printf("%s: OK\n", corpus);
+    }
+    return 0;
+}
+
+// Tryb --stages: pomiar etapow na korpusach syntetycznych (text, binary, random,
+// skewed) lub plikach. Opcje: --size=<MiB> (rozmiar korpusow syntetycznych),
+// --repeats=<n>, --format=text|csv|json.
+static int run_stages(int argc, char* argv[]) {
+    size_t size = 8 * 1024 * 1024;
+    int repeats = 5;
+    std::string format = "text";
+    std::vector<std::string> corpora;
+    for (int i = 2; i < argc; ++i) {
+        if (std::strncmp(argv[i], "--size=", 7) == 0) {
+            size = static_cast<size_t>(std::atof(argv[i] + 7) * 1024.0 * 1024.0);
+        } else if (std::strncmp(argv[i], "--repeats=", 10) == 0) {
+            repeats = std::atoi(argv[i] + 10);
+        } else if (std::strncmp(argv[i], "--format=", 9) == 0) {
+            format = argv[i] + 9;
+        } else {
+            corpora.push_back(argv[i]);
+        }
+    }
+    if (size == 0 || repeats <= 0 || (format != "text" && format != "csv" && format != "json")) {
+        std::fprintf(stderr, "Uzycie: huff_bench --stages [korpus...] [--size=MiB] [--repeats=n] [--format=text|csv|json]\n");
+        return 1;
+    }
+    if (corpora.empty()) corpora.assign(std::begin(Corpora::NAMES), std::end(Corpora::NAMES));
+
+    std::vector<StageResult> results;
+    for (const std::string& corpus : corpora) {
+        std::vector<uint8_t> input = Corpora::load(corpus, size);
+        if (!bench_stages(corpus, input, repeats, results)) {
+            std::fprintf(stderr, "%s: dekoder daje inny wynik!\n", corpus.c_str());
+            return 1;
+        }
+    }
+    print_stages(results, format, repeats);
+    return 0;
+}
+
+// Porownuje koder i dekoder bit po bicie z wersjami slowowa i tablicowa na podanym pliku.
+int main(int argc, char* argv[]) {
+    if (argc >= 2 && std::strcmp(argv[1], "--stages") == 0) {
+        return run_stages(argc, argv);
+    }
+    if (argc >= 2 && std::strcmp(argv[1], "--selftest") == 0) {
+        return run_selftest(argc, argv);
+    }
+    if (argc < 2) {
+        std::fprintf(stderr, "Uzycie: huff_bench <plik> [bity_tablicy] [powtorzenia]\n"
+                             "       huff_bench --selftest [--size=MiB]\n"
+                             "       huff_bench --stages [korpus...] [--size=MiB] [--repeats=n] [--format=text|csv|json]\n");
+        return 1;
+    }
+    const std::string input_path = argv[1];
+    const unsigned table_bits = argc > 2 ? static_cast<unsigned>(std::atoi(argv[2])) : DecodeTable::DEFAULT_BITS;
+    const int repeats = argc > 3 ? std::atoi(argv[3]) : 3;
+
+    ByteHistogram frequencies = FileHandler::count_bytes(input_path);
+    const HuffmanTree tree = HuffmanTree::from_frequencies(frequencies);
+
+    std::ifstream in(input_path, std::ios::binary);
+    std::vector<uint8_t> input((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    uint8_t padding = 0;
+    const CodeTable codes = tree.build_huffman_codes();
+    std::vector<uint8_t> payload = encode_bitwise(input, codes, padding);
+
+    std::ostringstream words;
+    if (encode_words(input, codes, words) != padding || words.str() != std::string(payload.begin(), payload.end())) {
+        std::fprintf(stderr, "Kodery daja rozne wyniki!\n");
+        return 1;
+    }
+
+    std::uint64_t original_size = 0;
+    for (uint64_t count : frequencies) original_size += count;
+
+    const unsigned hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::map<std::byte, uint32_t> map_counts = count_with_map(input);
+    for (unsigned s = 0; s < 256; ++s) {
+        auto found = map_counts.find(static_cast<std::byte>(s));
+        if ((found == map_counts.end() ? 0 : found->second) != frequencies[s]
+            || ByteCounter::count_parallel(input.data(), input.size(), hardware_threads)[s] != frequencies[s]) {
+            std::fprintf(stderr, "Histogramy sa rozne!\n");
+            return 1;
+        }
+    }
+    const double megabytes = static_cast<double>(original_size) / (1024.0 * 1024.0);
+
+    std::ostringstream expected;
+    std::ostringstream actual;
+    tree.decode_payload_bitwise(payload, padding, expected);
+    tree.decode_payload_to_stream(payload, padding, actual, table_bits);
+    if (expected.str() != actual.str()) {
+        std::fprintf(stderr, "Dekodery daja rozne wyniki!\n");
+        return 1;
+    }
+
+    double count_map = best_time(repeats, [&]() { map_counts = count_with_map(input); });
+    ByteHistogram histogram{};
+    // Wynik trafia do zmiennej volatile, zeby kompilator nie pominal liczenia.
+    volatile uint32_t sink = 0;
+    double count_flat = best_time(repeats, [&]() {
+        histogram = ByteHistogram{};
+        ByteCounter::count(input.data(), input.size(), histogram);
+        sink = sink + histogram[input[0]];
+    });
+    double count_threads = best_time(repeats, [&]() {
+        histogram = ByteCounter::count_parallel(input.data(), input.size(), hardware_threads);
+        sink = sink + histogram[input[0]];
+    });
+
+    // Budowa drzewa: czas i liczba alokacji na jedno drzewo.
+    const int tree_builds = 1000;
+    std::size_t allocations_before = allocation_count;
+    double tree_time = best_time(repeats, [&]() {
+        for (int i = 0; i < tree_builds; ++i) sink = sink + HuffmanTree::from_frequencies(frequencies).build_huffman_codes()[input[0]].length;
+    });
+    double tree_allocations = static_cast<double>(allocation_count - allocations_before) / (repeats * tree_builds);
+    double legacy_tree_time = best_time(repeats, [&]() {
+        for (int i = 0; i < tree_builds; ++i) sink = sink + HuffmanTree::from_frequencies(frequencies, true).build_huffman_codes()[input[0]].length;
+    });
+
+    // Ograniczenie dlugosci kodow: strata wzgledem drzewa bez ograniczenia.
+    const CodeLengths unlimited = CanonicalCodes::lengths_of(codes);
+    const uint64_t unlimited_bits = LengthLimitedCodes::encoded_bits(frequencies, unlimited);
+    const unsigned limits[] = {LengthLimitedCodes::MIN_LENGTH, 11, 12, 15, LengthLimitedCodes::longest(unlimited)};
+    std::vector<double> limit_loss;
+    std::vector<double> limit_time;
+    for (unsigned limit : limits) {
+        CodeLengths lengths{};
+        limit_time.push_back(best_time(repeats, [&]() { lengths = LengthLimitedCodes::build(frequencies, limit); }));
+        CanonicalCodes::from_lengths(lengths);
+        const uint64_t bits = LengthLimitedCodes::encoded_bits(frequencies, lengths);
+        if (LengthLimitedCodes::longest(lengths) > limit || bits < unlimited_bits
+            || (limit >= LengthLimitedCodes::longest(unlimited) && bits != unlimited_bits)) {
+            std::fprintf(stderr, "Niepoprawne dlugosci kodow przy limicie %u!\n", limit);
+            return 1;
+        }
+        limit_loss.push_back(100.0 * (static_cast<double>(bits) / static_cast<double>(unlimited_bits) - 1.0));
+    }
+
+    // Biblioteka w pamieci: testy poprawnosci i alokacji przed pomiarami.
+    if (!run_self_checks(input)) return 1;
+    HuffContext context;
+    std::vector<uint8_t> packed;
+    std::vector<uint8_t> unpacked;
+    HuffCodec::compress(context, input.data(), input.size(), packed);
+    HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+    allocations_before = allocation_count;
+    double codec_compress = best_time(repeats, [&]() { HuffCodec::compress(context, input.data(), input.size(), packed); });
+    double codec_decompress = best_time(repeats, [&]() {
+        HuffCodec::decompress(context, packed.data(), packed.size(), unpacked);
+    });
+    std::size_t codec_allocations = allocation_count - allocations_before;
+
+    // Dekodowanie z kilku przeplatanych strumieni w porownaniu z jednym strumieniem;
+    // oba do tej samej pamieci, jak w HuffCodec::decompress.
+    const DecodeTable decode_table(codes, table_bits);
+    std::vector<uint8_t> decoded(input.size());
+    double single_stream = best_time(repeats, [&]() {
+        MemoryPayloadSource source(payload.data(), payload.size(), static_cast<uint64_t>(payload.size()) * 8 - padding);
+        decode_table.decode(source, decoded.data(), decoded.size());
+    });
+    const unsigned stream_counts[] = {2, 4, 8};
+    std::vector<double> streams_time;
+    for (unsigned count : stream_counts) {
+        std::vector<std::vector<uint8_t>> streams(count);
+        std::vector<BitWriter> writers;
+        for (std::vector<uint8_t>& stream : streams) writers.emplace_back(stream);
+        HuffCodec::write_bits(input.data(), input.size(), codes, writers);
+
+        std::ostringstream interleaved;
+        tree.decode_payload_to_stream(streams, input.size(), interleaved, table_bits);
+        if (interleaved.str() != expected.str()) {
+            std::fprintf(stderr, "Dekoder %u strumieni daje inny wynik!\n", count);
+            return 1;
+        }
+        const uint8_t* data[DecodeTable::MAX_STREAMS];
+        size_t sizes[DecodeTable::MAX_STREAMS];
+        for (unsigned k = 0; k < count; ++k) {
+            data[k] = streams[k].data();
+            sizes[k] = streams[k].size();
+        }
+        streams_time.push_back(best_time(repeats, [&]() {
+            decode_table.decode_interleaved(data, sizes, count, input.size(), decoded.data());
+        }));
+    }
+
+    CountingBuffer bitwise_sink;
+    std::ostream bitwise_out(&bitwise_sink);
+    double bitwise = best_time(repeats, [&]() { tree.decode_payload_bitwise(payload, padding, bitwise_out); });
+
+    CountingBuffer table_sink;
+    std::ostream table_out(&table_sink);
+    double table = best_time(repeats, [&]() { tree.decode_payload_to_stream(payload, padding, table_out, table_bits); });
+
+    std::vector<uint8_t> scratch;
+    double encode_bits = best_time(repeats, [&]() { uint8_t p; scratch = encode_bitwise(input, codes, p); });
+
+    CountingBuffer words_sink;
+    std::ostream words_out(&words_sink);
+    double encode_word = best_time(repeats, [&]() { encode_words(input, codes, words_out); });
+
+    const std::pair<double, double> pipeline = bench_pipeline(input, std::chrono::milliseconds(2));
+
+    std::printf("plik: %s (%.2f MB)\n", input_path.c_str(), megabytes);
+    std::printf("histogram (std::map):          %8.1f MB/s\n", megabytes / count_map);
+    std::printf("histogram (4 podtablice):      %8.1f MB/s (x%.2f)\n", megabytes / count_flat, count_map / count_flat);
+    std::printf("histogram (%2u watkow):         %8.1f MB/s (x%.2f)\n", hardware_threads, megabytes / count_threads, count_map / count_threads);
+    std::printf("dekoder tablicowy do pamieci:  %8.1f MB/s\n", megabytes / single_stream);
+    for (size_t i = 0; i < streams_time.size(); ++i) {
+        std::printf("dekoder tablicowy, %u strumienie: %6.1f MB/s (x%.2f)\n", stream_counts[i],
+                    megabytes / streams_time[i], single_stream / streams_time[i]);
+    }
+    std::printf("HuffCodec::compress:           %8.1f MB/s\n", megabytes / codec_compress);
+    std::printf("HuffCodec::decompress:         %8.1f MB/s (%zu alokacji w %d przebiegach)\n",
+                megabytes / codec_decompress, codec_allocations, 2 * repeats);
+    std::printf("odczyt 2 ms/MiB, kolejno:      %8.1f MB/s\n", pipeline.first);
+    std::printf("odczyt 2 ms/MiB, potok:        %8.1f MB/s (x%.2f)\n", pipeline.second,
+                pipeline.second / pipeline.first);
+    std::printf("budowa drzewa (dwie kolejki):  %8.2f us, %.1f alokacji\n", tree_time * 1e6 / tree_builds, tree_allocations);
+    std::printf("budowa drzewa (stary format):  %8.2f us\n", legacy_tree_time * 1e6 / tree_builds);
+    for (size_t i = 0; i < limit_loss.size(); ++i) {
+        std::printf("kody do %2u bitow:              %+8.4f%% danych, package-merge %.1f us\n",
+                    limits[i], limit_loss[i], limit_time[i] * 1e6);
+    }
+    std::printf("koder bit po bicie:            %8.1f MB/s\n", megabytes / encode_bits);
+    std::printf("koder slowami 64-bitowymi:     %8.1f MB/s (x%.2f)\n", megabytes / encode_word, encode_bits / encode_word);
+    std::printf("dekoder bit po bicie:          %8.1f MB/s\n", megabytes / bitwise);
+    std::printf("dekoder tablicowy (%2u bitow):  %8.1f MB/s (x%.2f)\n", table_bits, megabytes / table, bitwise / table);
+    return 0;
+}
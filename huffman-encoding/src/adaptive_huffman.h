@@ -0,0 +1,239 @@
+#pragma once
+
+#include "bit_reader.h"
+#include "bit_writer.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+// Adaptacyjny kod Huffmana (algorytm FGK). Koder i dekoder zaczynaja od drzewa
+// z samym wezlem NYT ("not yet transmitted") i po kazdym symbolu zwiekszaja jego
+// wage, przestawiajac wezly tak, zeby drzewo pozostalo drzewem Huffmana. Nie ma
+// wiec naglowka ani przebiegu liczacego histogram - dane moga byc kodowane w miare
+// naplywania. Nowy symbol jest zapisywany jako kod NYT i 9 bitow wartosci, a
+// wartosc 256 po kodzie NYT konczy strumien.
+//
+// Wezly leza w tablicy "miejsc" numerowanych tak, ze wagi nie maleja wraz z numerem,
+// a rodzic ma wiekszy numer niz dzieci (wlasnosc rodzenstwa). Korzen ma numer ROOT.
+class AdaptiveHuffman {
+public:
+    AdaptiveHuffman() {
+        reset();
+    }
+
+    // Przywraca drzewo poczatkowe (sam wezel NYT).
+    void reset() {
+        weight.fill(0);
+        parent.fill(NONE);
+        left.fill(NONE);
+        right.fill(NONE);
+        symbol.fill(INTERNAL);
+        leaf_of.fill(NONE);
+        nyt = ROOT;
+        symbol[ROOT] = NYT;
+    }
+
+    // Koduje bajt i aktualizuje drzewo.
+    void encode(std::uint8_t byte, BitWriter& writer) {
+        std::int16_t leaf = leaf_of[byte];
+        if (leaf == NONE) {
+            write_path(nyt, writer);
+            writer.put(byte, RAW_BITS);
+        } else {
+            write_path(leaf, writer);
+        }
+        update(byte);
+    }
+
+    // Zapisuje znacznik konca strumienia (nie konczy BitWriter).
+    void encode_end(BitWriter& writer) {
+        write_path(nyt, writer);
+        writer.put(END, RAW_BITS);
+    }
+
+    // Dekoduje kolejny bajt i aktualizuje drzewo. Zwraca -1 na znaczniku konca.
+    int decode(BitReader& reader) {
+        std::int16_t node = ROOT;
+        while (symbol[node] == INTERNAL) node = reader.bit() ? right[node] : left[node];
+
+        std::uint8_t byte;
+        if (node == nyt) {
+            std::uint64_t raw = reader.read(RAW_BITS);
+            if (raw == END) return -1;
+            if (raw > 0xFF || leaf_of[raw] != NONE) throw std::runtime_error("Niepoprawne dane skompresowane");
+            byte = static_cast<std::uint8_t>(raw);
+        } else {
+            byte = static_cast<std::uint8_t>(symbol[node]);
+        }
+        update(byte);
+        return byte;
+    }
+
+    // Koduje strumien `in` do `out` w jednym przebiegu, fragment po fragmencie.
+    // Zwraca liczbe zakodowanych bajtow; w `payload_bytes` (jesli podano) zapisuje
+    // liczbe bajtow strumienia bitow przekazanych do `out`.
+    static std::uint64_t compress(std::istream& in, std::ostream& out, std::uint64_t* payload_bytes = nullptr) {
+        AdaptiveHuffman model;
+        BitWriter writer(out);
+        std::vector<std::uint8_t> chunk(CHUNK);
+        std::uint64_t total = 0;
+        while (in) {
+            in.read(reinterpret_cast<char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+            std::size_t n = static_cast<std::size_t>(in.gcount());
+            for (std::size_t i = 0; i < n; ++i) model.encode(chunk[i], writer);
+            total += n;
+        }
+        if (in.bad()) throw std::runtime_error("Wystąpił błąd odczytu pliku.");
+        model.encode_end(writer);
+        writer.finish();
+        if (payload_bytes) *payload_bytes = writer.bytes_written();
+        return total;
+    }
+
+    // Koduje dane z pamieci (bez sygnatury pliku) na koniec wektora `out`.
+    static void compress(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out) {
+        AdaptiveHuffman model;
+        BitWriter writer(out);
+        for (std::size_t i = 0; i < size; ++i) model.encode(data[i], writer);
+        model.encode_end(writer);
+        writer.finish();
+    }
+
+    // Dekoduje strumien az do znacznika konca, zapisujac bajty paczkami. Zwraca liczbe bajtow.
+    static std::uint64_t decompress(BitReader& reader, std::ostream& out) {
+        AdaptiveHuffman model;
+        std::vector<char> chunk(CHUNK);
+        std::size_t used = 0;
+        std::uint64_t total = 0;
+        while (true) {
+            int byte = model.decode(reader);
+            if (byte < 0) break;
+            chunk[used++] = static_cast<char>(byte);
+            if (used == chunk.size()) {
+                out.write(chunk.data(), static_cast<std::streamsize>(used));
+                total += used;
+                used = 0;
+            }
+        }
+        out.write(chunk.data(), static_cast<std::streamsize>(used));
+        return total + used;
+    }
+
+    // Dekoduje dane z pamieci zapisane przez compress na koniec wektora `out`.
+    static void decompress(const std::uint8_t* data, std::size_t size, std::vector<std::uint8_t>& out) {
+        AdaptiveHuffman model;
+        BitReader reader(data, size);
+        for (int byte = model.decode(reader); byte >= 0; byte = model.decode(reader)) {
+            out.push_back(static_cast<std::uint8_t>(byte));
+        }
+    }
+
+private:
+    // 256 lisci bajtow i lisc NYT.
+    static constexpr std::size_t MAX_NODES = 2 * 257 - 1;
+    static constexpr std::int16_t ROOT = MAX_NODES - 1;
+    static constexpr std::int16_t NONE = -1;
+    static constexpr std::int16_t INTERNAL = -1;
+    static constexpr std::int16_t NYT = 256;
+    static constexpr unsigned RAW_BITS = 9;
+    static constexpr std::uint64_t END = 256;
+    static constexpr std::size_t CHUNK = 64 * 1024;
+
+    std::array<std::uint64_t, MAX_NODES> weight;
+    std::array<std::int16_t, MAX_NODES> parent;
+    std::array<std::int16_t, MAX_NODES> left;
+    std::array<std::int16_t, MAX_NODES> right;
+    // Bajt liscia, NYT albo INTERNAL dla wezla wewnetrznego.
+    std::array<std::int16_t, MAX_NODES> symbol;
+    std::array<std::int16_t, 256> leaf_of;
+    std::int16_t nyt = ROOT;
+
+    // Zapisuje kod wezla (sciezke od korzenia). Sciezka jest zbierana od liscia
+    // w gore; ostatnie 64 bity trafiaja do jednego slowa, a dluzszy poczatek
+    // sciezki jest zapisywany wczesniej tym samym sposobem.
+    void write_path(std::int16_t node, BitWriter& writer) const {
+        std::uint64_t bits = 0;
+        unsigned length = 0;
+        std::int16_t n = node;
+        for (; n != ROOT && length < 64; n = parent[n]) {
+            if (right[parent[n]] == n) bits |= std::uint64_t{1} << length;
+            length++;
+        }
+        if (n != ROOT) write_path(n, writer);
+        if (length > 0) writer.put(bits, length);
+    }
+
+    // Zwieksza wage bajtu `byte` i przestawia wezly (FGK). Przed zwiekszeniem
+    // wagi wezel zamienia sie miejscem z liderem swojego bloku (wezlem
+    // o najwiekszym numerze i tej samej wadze), chyba ze lider jest jego rodzicem.
+    void update(std::uint8_t byte) {
+        std::int16_t node = leaf_of[byte];
+        if (node == NONE) {
+            // Nowy symbol: NYT dostaje dzieci - nowy NYT i lisc bajtu. Oba maja wage 0,
+            // a dawny NYT jest liderem wag 0, wiec obie wagi rosna bez zamiany.
+            std::int16_t old = nyt;
+            std::int16_t leaf = static_cast<std::int16_t>(old - 1);
+            nyt = static_cast<std::int16_t>(old - 2);
+            left[old] = nyt;
+            right[old] = leaf;
+            symbol[old] = INTERNAL;
+            parent[nyt] = old;
+            symbol[nyt] = NYT;
+            parent[leaf] = old;
+            symbol[leaf] = byte;
+            leaf_of[byte] = leaf;
+            weight[leaf] = 1;
+            weight[old] = 1;
+            if (old == ROOT) return;
+            node = parent[old];
+        }
+
+        while (true) {
+            std::int16_t leader = block_leader(node);
+            if (leader != node && leader != parent[node]) {
+                swap_slots(node, leader);
+                node = leader;
+            }
+            weight[node]++;
+            if (node == ROOT) return;
+            node = parent[node];
+        }
+    }
+
+    // Najwiekszy numer wezla o wadze wezla `node`. Wagi od `node` do korzenia
+    // nie maleja (tylko dziecko zwiekszone przed chwila moze ja naruszac,
+    // a lezy ponizej), wiec wystarczy wyszukiwanie binarne.
+    std::int16_t block_leader(std::int16_t node) const {
+        auto first = weight.begin() + node;
+        auto last = std::upper_bound(first, weight.end(), weight[node]);
+        return static_cast<std::int16_t>(last - weight.begin() - 1);
+    }
+
+    // Zamienia miejscami poddrzewa w miejscach `a` i `b` (o rownych wagach).
+    // Rodzice zostaja przy miejscach, przenosi sie zawartosc.
+    void swap_slots(std::int16_t a, std::int16_t b) {
+        std::swap(left[a], left[b]);
+        std::swap(right[a], right[b]);
+        std::swap(symbol[a], symbol[b]);
+        attach(a);
+        attach(b);
+    }
+
+    // Uaktualnia odwolania do zawartosci miejsca `slot` (rodzic dzieci, lisc bajtu, NYT).
+    void attach(std::int16_t slot) {
+        if (symbol[slot] == INTERNAL) {
+            parent[left[slot]] = slot;
+            parent[right[slot]] = slot;
+        } else if (symbol[slot] == NYT) {
+            nyt = slot;
+        } else {
+            leaf_of[symbol[slot]] = slot;
+        }
+    }
+};
@@ -1,12 +1,24 @@
 #include "arg_paraser.h"
+#include "huff_codec.h"
+#include "length_limited_codes.h"
+#include "huff_format.h"
+#include "pipeline.h"
 
+#include <algorithm>
 #include <cstring>
+#include <filesystem>
 #include <string>
 #include <stdexcept>
 #include <regex>
+#include <thread>
 
 std::regex INPUT_REGEX{R"(^[A-Za-z0-9._\-\\/:]+$)"};
 std::regex OUTPUT_REGEX{R"(^[A-Za-z0-9._\-\\/:]+$)"};
+std::regex NUMBER_REGEX{R"(^[0-9]{1,4}$)"};
+std::regex BLOCK_SIZE_REGEX{R"(^[0-9]{1,5}$)"};
+std::regex RANGE_REGEX{R"(^([0-9]{1,19})-([0-9]{0,19})$)"};
+// Najwiekszy rozmiar bloku (--block-size) w KiB.
+const unsigned long MAX_BLOCK_KIB = 65536;
 
 // Sprawdza, czy napis ma wskazany sufiks.
 bool ends_with(const std::string& str, const std::string& suffix) {
@@ -28,10 +40,32 @@ std::string remove_huff_extension(const std::string& path) {
     return path;
 }
 
+// Sprawdza, czy kolejny argument jest opcja ("-" samo w sobie oznacza stdin/stdout).
+bool is_option_arg(const char* arg) {
+    return arg[0] == '-' && arg[1] != '\0';
+}
+
+// Sprawdza, czy sciezka wskazuje istniejacy katalog.
+bool is_directory_path(const std::string& path) {
+    std::error_code error;
+    return std::filesystem::is_directory(path, error);
+}
+
 // Waliduje argumenty i buduje strukture Arguments.
 Arguments ArgumentParaser::parse_args(int argc, char** argv) {
+    // Z lista plikow (-f) opcje -c i -d nie wymagaja sciezki.
+    const bool has_list = std::any_of(argv + 1, argv + argc, [](const char* arg) { return std::strcmp(arg, "-f") == 0; });
     bool is_mode_selected = false;
+    bool is_list_selected = false;
     bool is_output_path_selected = false;
+    bool is_threads_selected = false;
+    bool is_range_selected = false;
+    bool is_io_selected = false;
+    bool is_length_selected = false;
+    bool is_streams_selected = false;
+    bool is_model_selected = false;
+    bool is_table_selected = false;
+    bool is_min_gain_selected = false;
     std::string input_path;
     std::string output_path;
     Arguments output_args;
@@ -41,12 +75,17 @@ Arguments ArgumentParaser::parse_args(int argc, char** argv) {
 
         if (std::strcmp(argv[i], "-c") == 0) {
             if (is_mode_selected) {
-                throw std::runtime_error("Tylko jedna z opcji (-c, -d) może być aktywna w czasie użycia.");
+                throw std::runtime_error("Tylko jedna z opcji (-c, -d, --train) może być aktywna w czasie użycia.");
+            }
+            if (has_list && (!is_enough_args || is_option_arg(argv[i + 1]))) {
+                is_mode_selected = true;
+                output_args.mode = MODE::COMPRESS;
+                continue;
             }
             if (!is_enough_args) {
                 throw std::runtime_error("Podano za mało argumentów. Opcja (-c [ścieżka_do_pliku]) oczekuje ścieżki do pliku wejściowego.");
             }
-            bool is_option = argv[i + 1][0] == '-';
+            bool is_option = is_option_arg(argv[i + 1]);
             if (is_option) {
                 throw std::runtime_error("Oczekiwano argumentu [ścieżka_do_pliku] dla (-c [ścieżka_do_pliku]). Otrzymano kolejną opcję.");
             }
@@ -63,12 +102,17 @@ Arguments ArgumentParaser::parse_args(int argc, char** argv) {
 
         if (std::strcmp(argv[i], "-d") == 0) {
             if (is_mode_selected) {
-                throw std::runtime_error("Tylko jedna z opcji (-c, -d) może być aktywna w czasie użycia.");
+                throw std::runtime_error("Tylko jedna z opcji (-c, -d, --train) może być aktywna w czasie użycia.");
+            }
+            if (has_list && (!is_enough_args || is_option_arg(argv[i + 1]))) {
+                is_mode_selected = true;
+                output_args.mode = MODE::DECOMPRESS;
+                continue;
             }
             if (!is_enough_args) {
                 throw std::runtime_error("Podano za mało argumentów. Opcja (-d [ścieżka_do_pliku]) oczekuje ścieżki do pliku wejściowego.");
             }
-            bool is_option = argv[i + 1][0] == '-';
+            bool is_option = is_option_arg(argv[i + 1]);
             if (is_option) {
                 throw std::runtime_error("Oczekiwano argumentu [ścieżka_do_pliku] dla (-d [ścieżka_do_pliku]). Otrzymano kolejną opcję.");
             }
@@ -78,7 +122,7 @@ Arguments ArgumentParaser::parse_args(int argc, char** argv) {
             }
 
             std::string candidate = std::string(argv[i + 1]);
-            if (!ends_with_huff(candidate)) {
+            if (!is_standard_stream(candidate) && !ends_with_huff(candidate) && !is_directory_path(candidate)) {
                 throw std::runtime_error("Dekomresja (-d) wymaga pliku wejściowego z rozszerzeniem .huff");
             }
 
@@ -89,6 +133,44 @@ Arguments ArgumentParaser::parse_args(int argc, char** argv) {
             continue;
         }
 
+        if (std::strcmp(argv[i], "--train") == 0) {
+            if (is_mode_selected) {
+                throw std::runtime_error("Tylko jedna z opcji (-c, -d, --train) może być aktywna w czasie użycia.");
+            }
+            if (has_list && (!is_enough_args || is_option_arg(argv[i + 1]))) {
+                is_mode_selected = true;
+                output_args.mode = MODE::TRAIN;
+                continue;
+            }
+            if (!is_enough_args || is_option_arg(argv[i + 1])) {
+                throw std::runtime_error("Podano za mało argumentów. Opcja (--train [ścieżka_próbki]) oczekuje pliku lub katalogu z próbką danych.");
+            }
+            if (!std::regex_match(argv[i + 1], INPUT_REGEX)) {
+                throw std::runtime_error("Ścieżka próbki przy (--train [ścieżka_próbki]) ma niewłaściwy format. Format musi spełniać wyrażenie [^[A-Za-z0-9._-]+$].");
+            }
+            is_mode_selected = true;
+            output_args.mode = MODE::TRAIN;
+            input_path = std::string(argv[i + 1]);
+            i++;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "--table") == 0) {
+            if (is_table_selected) {
+                throw std::runtime_error("Tablicę kodów (--table [plik_tablicy]) można wybrać tylko raz.");
+            }
+            if (!is_enough_args || is_option_arg(argv[i + 1])) {
+                throw std::runtime_error("Podano za mało argumentów. Opcja (--table [plik_tablicy]) oczekuje pliku tablicy kodów.");
+            }
+            if (!std::regex_match(argv[i + 1], INPUT_REGEX) || is_standard_stream(argv[i + 1])) {
+                throw std::runtime_error("Ścieżka tablicy kodów przy (--table [plik_tablicy]) ma niewłaściwy format. Format musi spełniać wyrażenie [^[A-Za-z0-9._-]+$].");
+            }
+            is_table_selected = true;
+            output_args.table_path = std::string(argv[i + 1]);
+            i++;
+            continue;
+        }
+
         if (std::strcmp(argv[i], "-o") == 0) {
             if (is_output_path_selected) {
                 throw std::runtime_error("Nazwę pliku wyjściowego (-o [nazwa_wyjścia]) można wybrać tylko raz.");
@@ -96,7 +178,7 @@ Arguments ArgumentParaser::parse_args(int argc, char** argv) {
             if (!is_enough_args) {
                 throw std::runtime_error("Podano za mało argumentów. Opcja (-o [nazwa_pliku]) oczekuje nazwy pliku wyjściowego.");
             }
-            bool is_option = argv[i + 1][0] == '-';
+            bool is_option = is_option_arg(argv[i + 1]);
             if (is_option) {
                 throw std::runtime_error("Oczekiwano argumentu [nazwa_pliku] dla (-o [nazwa_pliku]). Otrzymano kolejną opcję.");
             }
@@ -110,27 +192,316 @@ Arguments ArgumentParaser::parse_args(int argc, char** argv) {
             continue;
         }
 
+        if (std::strcmp(argv[i], "-j") == 0) {
+            if (is_threads_selected) {
+                throw std::runtime_error("Liczbę wątków (-j [liczba_wątków]) można wybrać tylko raz.");
+            }
+            if (!is_enough_args) {
+                throw std::runtime_error("Podano za mało argumentów. Opcja (-j [liczba_wątków]) oczekuje liczby wątków.");
+            }
+            bool is_match_regex = std::regex_match(argv[i + 1], NUMBER_REGEX);
+            if (!is_match_regex || std::stoul(argv[i + 1]) == 0) {
+                throw std::runtime_error("Liczba wątków przy (-j [liczba_wątków]) musi być liczbą całkowitą z zakresu 1-9999.");
+            }
+            is_threads_selected = true;
+            output_args.threads = static_cast<unsigned>(std::stoul(argv[i + 1]));
+            i++;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "-l") == 0) {
+            if (is_length_selected) {
+                throw std::runtime_error("Maksymalną długość kodu (-l [liczba_bitów]) można wybrać tylko raz.");
+            }
+            if (!is_enough_args) {
+                throw std::runtime_error("Podano za mało argumentów. Opcja (-l [liczba_bitów]) oczekuje maksymalnej długości kodu.");
+            }
+            bool is_match_regex = std::regex_match(argv[i + 1], NUMBER_REGEX);
+            unsigned long length = is_match_regex ? std::stoul(argv[i + 1]) : 0;
+            if (length < LengthLimitedCodes::MIN_LENGTH || length > LengthLimitedCodes::MAX_LENGTH) {
+                throw std::runtime_error("Maksymalna długość kodu przy (-l [liczba_bitów]) musi być liczbą całkowitą z zakresu 8-63.");
+            }
+            is_length_selected = true;
+            output_args.max_code_length = static_cast<unsigned>(length);
+            i++;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "-s") == 0) {
+            if (is_streams_selected) {
+                throw std::runtime_error("Liczbę strumieni (-s [liczba_strumieni]) można wybrać tylko raz.");
+            }
+            if (!is_enough_args) {
+                throw std::runtime_error("Podano za mało argumentów. Opcja (-s [liczba_strumieni]) oczekuje liczby strumieni.");
+            }
+            bool is_match_regex = std::regex_match(argv[i + 1], NUMBER_REGEX);
+            unsigned long streams = is_match_regex ? std::stoul(argv[i + 1]) : 0;
+            if (streams < 1 || streams > HuffFormat::MAX_STREAMS) {
+                throw std::runtime_error("Liczba strumieni przy (-s [liczba_strumieni]) musi być liczbą całkowitą z zakresu 1-8.");
+            }
+            is_streams_selected = true;
+            output_args.streams = static_cast<unsigned>(streams);
+            i++;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "-m") == 0) {
+            if (is_model_selected) {
+                throw std::runtime_error("Rząd modelu (-m [rząd]) można wybrać tylko raz.");
+            }
+            if (!is_enough_args) {
+                throw std::runtime_error("Podano za mało argumentów. Opcja (-m [rząd]) oczekuje rzędu modelu.");
+            }
+            if (std::strcmp(argv[i + 1], "0") != 0 && std::strcmp(argv[i + 1], "1") != 0) {
+                throw std::runtime_error("Rząd modelu przy (-m [rząd]) może wynosić tylko 0 albo 1.");
+            }
+            is_model_selected = true;
+            output_args.model_order = static_cast<unsigned>(argv[i + 1][0] - '0');
+            i++;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "-f") == 0) {
+            if (is_list_selected) {
+                throw std::runtime_error("Listę plików (-f [plik_listy]) można wybrać tylko raz.");
+            }
+            if (!is_enough_args || is_option_arg(argv[i + 1])) {
+                throw std::runtime_error("Podano za mało argumentów. Opcja (-f [plik_listy]) oczekuje pliku z listą ścieżek.");
+            }
+            if (!std::regex_match(argv[i + 1], INPUT_REGEX) || is_standard_stream(argv[i + 1])) {
+                throw std::runtime_error("Ścieżka listy plików przy (-f [plik_listy]) ma niewłaściwy format. Format musi spełniać wyrażenie [^[A-Za-z0-9._-]+$].");
+            }
+            is_list_selected = true;
+            output_args.list_path = std::string(argv[i + 1]);
+            i++;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "--stats") == 0 || std::strcmp(argv[i], "--json") == 0) {
+            if (output_args.stats != STATS::NONE) {
+                throw std::runtime_error("Tylko jedna z opcji (--stats, --json) może być aktywna w czasie użycia.");
+            }
+            output_args.stats = std::strcmp(argv[i], "--json") == 0 ? STATS::JSON : STATS::TEXT;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "-a") == 0) {
+            output_args.adaptive = true;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "-x") == 0) {
+            output_args.with_index = true;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "--checksum") == 0) {
+            output_args.checksum = true;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "-r") == 0) {
+            if (is_range_selected) {
+                throw std::runtime_error("Zakres (-r [początek-koniec]) można wybrać tylko raz.");
+            }
+            if (!is_enough_args) {
+                throw std::runtime_error("Podano za mało argumentów. Opcja (-r [początek-koniec]) oczekuje zakresu bajtów.");
+            }
+            std::cmatch match;
+            if (!std::regex_match(argv[i + 1], match, RANGE_REGEX)) {
+                throw std::runtime_error("Zakres przy (-r [początek-koniec]) ma niewłaściwy format. Format musi spełniać wyrażenie [^[0-9]+-[0-9]*$].");
+            }
+            output_args.range_begin = std::stoull(match[1].str());
+            if (match[2].length() > 0) {
+                output_args.range_end = std::stoull(match[2].str());
+            }
+            if (output_args.range_begin >= output_args.range_end) {
+                throw std::runtime_error("Początek zakresu (-r [początek-koniec]) musi być mniejszy niż jego koniec.");
+            }
+            is_range_selected = true;
+            i++;
+            continue;
+        }
+
+        if (std::strncmp(argv[i], "--io=", 5) == 0) {
+            if (is_io_selected) {
+                throw std::runtime_error("Sposób dostępu do plików (--io=[mmap|stream]) można wybrać tylko raz.");
+            }
+            std::string io_mode = argv[i] + 5;
+            if (io_mode == "mmap") {
+                output_args.io_mode = IoMode::MMAP;
+            } else if (io_mode == "stream") {
+                output_args.io_mode = IoMode::STREAM;
+            } else {
+                throw std::runtime_error("Opcja (--io=[mmap|stream]) przyjmuje tylko wartości mmap albo stream.");
+            }
+            is_io_selected = true;
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "--pipeline") == 0 || std::strncmp(argv[i], "--pipeline=", 11) == 0) {
+            if (output_args.pipeline != 0) {
+                throw std::runtime_error("Potok odczyt-kodowanie-zapis (--pipeline[=liczba_buforów]) można wybrać tylko raz.");
+            }
+            unsigned long buffers = Pipeline::DEFAULT_BUFFERS;
+            if (argv[i][10] == '=') {
+                buffers = std::regex_match(argv[i] + 11, NUMBER_REGEX) ? std::stoul(argv[i] + 11) : 0;
+            }
+            if (buffers < 1 || buffers > Pipeline::MAX_BUFFERS) {
+                throw std::runtime_error("Liczba buforów przy (--pipeline=[liczba_buforów]) musi być liczbą całkowitą z zakresu 1-256.");
+            }
+            output_args.pipeline = static_cast<unsigned>(buffers);
+            continue;
+        }
+
+        if (std::strcmp(argv[i], "--sample") == 0 || std::strncmp(argv[i], "--sample=", 9) == 0) {
+            if (output_args.sample != 0) {
+                throw std::runtime_error("Histogram z próbki (--sample[=dzielnik]) można wybrać tylko raz.");
+            }
+            unsigned long divisor = CodecOptions::DEFAULT_SAMPLE;
+            if (argv[i][8] == '=') {
+                divisor = std::regex_match(argv[i] + 9, NUMBER_REGEX) ? std::stoul(argv[i] + 9) : 0;
+            }
+            if (divisor < 2 || divisor > CodecOptions::MAX_SAMPLE) {
+                throw std::runtime_error("Dzielnik próbki przy (--sample=[dzielnik]) musi być liczbą całkowitą z zakresu 2-256.");
+            }
+            output_args.sample = static_cast<unsigned>(divisor);
+            continue;
+        }
+
+        if (std::strncmp(argv[i], "--block-size=", 13) == 0) {
+            if (output_args.block_size != 0) {
+                throw std::runtime_error("Rozmiar bloku (--block-size=[KiB]) można wybrać tylko raz.");
+            }
+            unsigned long kib = std::regex_match(argv[i] + 13, BLOCK_SIZE_REGEX) ? std::stoul(argv[i] + 13) : 0;
+            if (kib < 1 || kib > MAX_BLOCK_KIB) {
+                throw std::runtime_error("Rozmiar bloku przy (--block-size=[KiB]) musi być liczbą całkowitą z zakresu 1-65536.");
+            }
+            output_args.block_size = static_cast<size_t>(kib) * 1024;
+            continue;
+        }
+
+        if (std::strncmp(argv[i], "--min-gain=", 11) == 0) {
+            if (is_min_gain_selected) {
+                throw std::runtime_error("Minimalny zysk kompresji (--min-gain=[procent]) można wybrać tylko raz.");
+            }
+            unsigned long gain = std::regex_match(argv[i] + 11, NUMBER_REGEX) ? std::stoul(argv[i] + 11) : 100;
+            if (gain > 99) {
+                throw std::runtime_error("Minimalny zysk kompresji przy (--min-gain=[procent]) musi być liczbą całkowitą z zakresu 0-99.");
+            }
+            is_min_gain_selected = true;
+            output_args.min_gain = static_cast<unsigned>(gain);
+            continue;
+        }
+
         throw std::runtime_error(std::string("Nieznana opcja: ") + argv[i]);
     }
 
     if (!is_mode_selected) {
-        throw std::runtime_error("Nie wybrano trybu pracy. Użyj -c [ścieżka_do_pliku] albo -d [ścieżka_do_pliku].");
+        throw std::runtime_error("Nie wybrano trybu pracy. Użyj -c [ścieżka_do_pliku], -d [ścieżka_do_pliku] albo --train [ścieżka_próbki].");
+    }
+    if (is_list_selected && !input_path.empty()) {
+        throw std::runtime_error("Lista plików (-f [plik_listy]) zastępuje ścieżkę przy opcji -c albo -d.");
     }
-    if (input_path.empty()) {
+    if (input_path.empty() && !is_list_selected) {
         throw std::runtime_error("Nie podano ścieżki pliku wejściowego.");
     }
 
+    if (output_args.mode == MODE::TRAIN) {
+        if (output_args.with_index || is_streams_selected || is_model_selected || output_args.adaptive
+            || is_range_selected || is_table_selected || is_threads_selected || is_min_gain_selected
+            || output_args.checksum || output_args.pipeline != 0 || output_args.block_size != 0 || output_args.sample != 0
+            || output_args.stats != STATS::NONE) {
+            throw std::runtime_error("Budowa tablicy kodów (--train) przyjmuje tylko opcje -o, -l, -f i --io.");
+        }
+        // Probka moze byc plikiem, katalogiem (rekurencyjnie) albo lista plikow (-f).
+        output_args.input_path = input_path;
+        output_args.batch = is_list_selected || is_directory_path(input_path);
+        output_args.output_path = is_output_path_selected ? output_path
+            : (input_path.empty() ? output_args.list_path : input_path) + ".huft";
+        if (is_standard_stream(output_args.output_path)) {
+            throw std::runtime_error("Tablica kodów (--train) jest zapisywana do pliku, a nie na standardowe wyjście.");
+        }
+        return output_args;
+    }
+    if (is_table_selected && (output_args.with_index || is_streams_selected || is_length_selected
+                              || is_model_selected || output_args.adaptive || is_range_selected)) {
+        throw std::runtime_error("Kompresja wspólną tablicą kodów (--table) nie dzieli danych na bloki i nie łączy się z opcjami -x, -s, -l, -m, -a ani -r.");
+    }
+
+    if (output_args.with_index && output_args.mode != MODE::COMPRESS) {
+        throw std::runtime_error("Opcja (-x) zapisuje indeks bloków i działa tylko z kompresją (-c).");
+    }
+    if (is_streams_selected && output_args.mode != MODE::COMPRESS) {
+        throw std::runtime_error("Opcja (-s [liczba_strumieni]) działa tylko z kompresją (-c).");
+    }
+    if (is_length_selected && output_args.mode != MODE::COMPRESS) {
+        throw std::runtime_error("Opcja (-l [liczba_bitów]) działa tylko z kompresją (-c).");
+    }
+    if (output_args.pipeline != 0 && (output_args.adaptive || is_table_selected)) {
+        throw std::runtime_error("Potok (--pipeline) działa tylko z kontenerem blokowym (bez -a i --table).");
+    }
+    if (output_args.block_size != 0 && (output_args.mode != MODE::COMPRESS || output_args.adaptive || is_table_selected)) {
+        throw std::runtime_error("Opcja (--block-size=[KiB]) działa tylko z kompresją blokową (-c bez -a i --table).");
+    }
+    if (output_args.checksum && (output_args.mode != MODE::COMPRESS || output_args.adaptive || is_table_selected)) {
+        throw std::runtime_error("Opcja (--checksum) działa tylko z kompresją blokową (-c bez -a i --table); dekompresja sprawdza sumy sama.");
+    }
+    if (output_args.sample != 0 && (output_args.mode != MODE::COMPRESS || output_args.adaptive || is_table_selected)) {
+        throw std::runtime_error("Opcja (--sample[=dzielnik]) działa tylko z kompresją blokową (-c bez -a i --table).");
+    }
+    if (output_args.sample != 0 && output_args.model_order == 1) {
+        throw std::runtime_error("Histogram z próbki (--sample) nie łączy się z modelem rzędu 1 (-m 1).");
+    }
+    if (is_min_gain_selected && (output_args.mode != MODE::COMPRESS || output_args.adaptive || is_table_selected)) {
+        throw std::runtime_error("Opcja (--min-gain=[procent]) działa tylko z kompresją blokową (-c bez -a i --table).");
+    }
+    if (is_model_selected && output_args.mode != MODE::COMPRESS) {
+        throw std::runtime_error("Opcja (-m [rząd]) działa tylko z kompresją (-c).");
+    }
+    if (output_args.model_order == 1 && output_args.streams > 1) {
+        throw std::runtime_error("Model rzędu 1 (-m 1) nie łączy się z przeplatanymi strumieniami (-s).");
+    }
+    if (output_args.adaptive && output_args.mode != MODE::COMPRESS) {
+        throw std::runtime_error("Opcja (-a) działa tylko z kompresją (-c); dekompresja rozpoznaje format sama.");
+    }
+    if (output_args.adaptive && (output_args.with_index || is_streams_selected || is_length_selected || is_model_selected)) {
+        throw std::runtime_error("Kompresja adaptacyjna (-a) nie dzieli danych na bloki i nie łączy się z opcjami -x, -s, -l ani -m.");
+    }
+    if (is_range_selected && output_args.mode != MODE::DECOMPRESS) {
+        throw std::runtime_error("Opcja (-r [początek-koniec]) działa tylko z dekompresją (-d).");
+    }
+
     output_args.input_path = input_path;
 
+    output_args.batch = is_list_selected || is_directory_path(input_path);
+    if (output_args.batch) {
+        if (is_range_selected) {
+            throw std::runtime_error("Opcja (-r [początek-koniec]) nie działa w trybie wsadowym (katalog lub -f).");
+        }
+        if (is_output_path_selected && is_standard_stream(output_path)) {
+            throw std::runtime_error("W trybie wsadowym (-o [katalog]) wskazuje katalog wyników, a nie standardowe wyjście.");
+        }
+        // Wyniki trafiaja do katalogu -o z zachowaniem drzewa katalogow albo obok plikow wejsciowych.
+        output_args.output_path = output_path;
+        if (!is_threads_selected) {
+            output_args.threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        return output_args;
+    }
+
     if (!is_output_path_selected) {
-        if (output_args.mode == MODE::COMPRESS) {
+        if (is_standard_stream(input_path)) {
+            output_args.output_path = input_path;
+        } else if (output_args.mode == MODE::COMPRESS) {
             output_args.output_path = input_path + ".huff";
         } else {
             output_args.output_path = remove_huff_extension(input_path);
         }
     } else {
         output_args.output_path = output_path;
-        if (output_args.mode == MODE::COMPRESS && !ends_with_huff(output_args.output_path)) {
+        if (output_args.mode == MODE::COMPRESS && !is_standard_stream(output_args.output_path)
+            && !ends_with_huff(output_args.output_path)) {
             output_args.output_path += ".huff";
         }
     }
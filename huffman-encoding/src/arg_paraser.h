@@ -2,16 +2,58 @@
 
 #include <string>
 #include <regex>
+#include <cstddef>
+#include <cstdint>
+
+#include "file_io.h"
 
 enum class MODE {
     COMPRESS,
-    DECOMPRESS
+    DECOMPRESS,
+    // Budowa wspolnej tablicy kodow z probki (--train).
+    TRAIN
+};
+
+// Podsumowanie pomiarow po zakonczeniu (--stats - tekst, --json - JSON) na stderr.
+enum class STATS {
+    NONE,
+    TEXT,
+    JSON
 };
 
 struct Arguments{
     MODE mode;
     std::string input_path;
     std::string output_path;
+    unsigned threads = 1;
+    bool with_index = false;
+    uint64_t range_begin = 0;
+    uint64_t range_end = UINT64_MAX;
+    IoMode io_mode = IoMode::STREAM;
+    unsigned max_code_length = 0;
+    unsigned streams = 1;
+    // Rzad modelu (-m): 0 - jedne kody na blok, 1 - kody zalezne od poprzedniego bajtu.
+    unsigned model_order = 0;
+    // Minimalny zysk bloku w procentach (--min-gain); blok o mniejszym zysku jest zapisywany bez kodowania.
+    unsigned min_gain = 1;
+    // Suma kontrolna CRC-32C danych kazdego bloku (--checksum).
+    bool checksum = false;
+    // Histogram z co `sample`-tego odcinka bloku (--sample; 0 - pelny histogram).
+    unsigned sample = 0;
+    // Liczba buforow potoku odczyt-kodowanie-zapis (--pipeline; 0 - bez potoku).
+    unsigned pipeline = 0;
+    // Rozmiar bloku w bajtach (--block-size; 0 - domyslny).
+    size_t block_size = 0;
+    // Adaptacyjny kod Huffmana (-a) zamiast kontenera blokowego.
+    bool adaptive = false;
+    // Plik wspolnej tablicy kodow (--table) dla -c i -d; pusty - kody z danych.
+    std::string table_path;
+    // Tryb wsadowy: katalog wejsciowy albo lista plikow (`list_path`); output_path to
+    // katalog wynikow (pusty - wyniki obok plikow wejsciowych), a threads - liczba plikow naraz.
+    // Przy --train katalog albo lista to pliki probki, a output_path - plik tablicy.
+    bool batch = false;
+    std::string list_path;
+    STATS stats = STATS::NONE;
 };
 
 class ArgumentParaser {
@@ -0,0 +1,163 @@
+#pragma once
+
+#include "file_handler.h"
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+#include <vector>
+
+// Plik do przetworzenia w trybie wsadowym i sciezka jego wyniku.
+struct BatchItem {
+    std::filesystem::path input;
+    std::filesystem::path output;
+    std::uint64_t size = 0;
+};
+
+// Wynik przetwarzania wielu plikow.
+struct BatchReport {
+    std::size_t files = 0;
+    std::uint64_t input_bytes = 0;
+    std::uint64_t output_bytes = 0;
+    // Pliki, ktorych nie udalo sie przetworzyc, i opis bledu (w kolejnosci listy plikow).
+    std::vector<std::pair<std::string, std::string>> errors;
+};
+
+// Kompresja i dekompresja wielu plikow w jednym procesie. Wyniki odtwarzaja
+// drzewo katalogow wejscia pod `output_root`; pusty `output_root` oznacza
+// zapis obok plikow wejsciowych.
+class BatchProcessor {
+public:
+    // Zbiera rekurencyjnie pliki z katalogu. Przy kompresji pomijane sa pliki .huff,
+    // przy dekompresji brane sa tylko pliki .huff.
+    static std::vector<BatchItem> from_directory(const std::string& directory, bool compress,
+                                                 const std::string& output_root) {
+        namespace fs = std::filesystem;
+        std::vector<BatchItem> items;
+        const fs::path root(directory);
+        for (const fs::directory_entry& entry :
+             fs::recursive_directory_iterator(root, fs::directory_options::skip_permission_denied)) {
+            if (!entry.is_regular_file()) continue;
+            bool is_huff = entry.path().extension() == HUFF_EXTENSION;
+            if (is_huff == compress) continue;
+            BatchItem item;
+            item.input = entry.path();
+            item.output = output_for(item.input, item.input.lexically_relative(root), compress, output_root);
+            item.size = entry.file_size();
+            items.push_back(std::move(item));
+        }
+        return items;
+    }
+
+    // Czyta liste plikow (jedna sciezka w linii, puste linie sa pomijane). Pod
+    // `output_root` sciezki bezwzgledne traca korzen, a wzgledne - skladniki "..".
+    static std::vector<BatchItem> from_list(const std::string& list_path, bool compress,
+                                            const std::string& output_root) {
+        namespace fs = std::filesystem;
+        std::ifstream list(list_path);
+        if (!list) throw std::runtime_error("Nie mozna otworzyc listy plikow");
+
+        std::vector<BatchItem> items;
+        std::string line;
+        while (std::getline(list, line)) {
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            BatchItem item;
+            item.input = fs::path(line).lexically_normal();
+            fs::path relative;
+            for (const fs::path& part : item.input.relative_path()) {
+                if (part != "..") relative /= part;
+            }
+            item.output = output_for(item.input, relative, compress, output_root);
+            std::error_code error;
+            item.size = fs::file_size(item.input, error);
+            if (error) item.size = 0;
+            items.push_back(std::move(item));
+        }
+        return items;
+    }
+
+    // Przetwarza pliki na `threads` watkach puli z kradzieza zadan. Pliki sa
+    // rozdzielane od najwiekszych, a kazdy plik jest kodowany na jednym watku.
+    // Blad jednego pliku trafia do raportu i nie przerywa pozostalych.
+    static BatchReport run(std::vector<BatchItem>& items, bool compress, const CompressOptions& options,
+                           unsigned threads) {
+        std::stable_sort(items.begin(), items.end(),
+                         [](const BatchItem& a, const BatchItem& b) { return a.size > b.size; });
+
+        CompressOptions file_options = options;
+        file_options.threads = 1;
+        std::vector<std::string> errors(items.size());
+        std::vector<std::uint64_t> output_sizes(items.size(), 0);
+
+        WorkStealingPool::run(threads, items.size(), [&](std::size_t index) {
+            const BatchItem& item = items[index];
+            try {
+                if (compress && item.input.extension() == HUFF_EXTENSION) {
+                    throw std::runtime_error("Plik ma juz rozszerzenie .huff");
+                }
+                if (!compress && item.input.extension() != HUFF_EXTENSION) {
+                    throw std::runtime_error("Dekompresja wymaga pliku z rozszerzeniem .huff");
+                }
+                create_parent(item.output);
+                if (compress) {
+                    FileHandler::compress_file(item.input.string(), item.output.string(), file_options);
+                } else {
+                    FileHandler::decompress_file(item.input.string(), item.output.string(), 1, 0, UINT64_MAX,
+                                                 file_options.io_mode, file_options.stats, file_options.table,
+                                                 file_options.pipeline);
+                }
+                output_sizes[index] = std::filesystem::file_size(item.output);
+            } catch (const std::exception& e) {
+                errors[index] = e.what();
+                if (errors[index].empty()) errors[index] = "Nieznany blad";
+            }
+        });
+
+        BatchReport report;
+        for (std::size_t i = 0; i < items.size(); ++i) {
+            report.files++;
+            if (!errors[i].empty()) {
+                report.errors.emplace_back(items[i].input.string(), errors[i]);
+                continue;
+            }
+            report.input_bytes += items[i].size;
+            report.output_bytes += output_sizes[i];
+        }
+        return report;
+    }
+
+private:
+    static constexpr const char* HUFF_EXTENSION = ".huff";
+
+    // Sciezka wyniku: obok wejscia albo pod `output_root` z zachowaniem sciezki wzglednej.
+    static std::filesystem::path output_for(const std::filesystem::path& input, const std::filesystem::path& relative,
+                                            bool compress, const std::string& output_root) {
+        std::filesystem::path target = output_root.empty() ? input : std::filesystem::path(output_root) / relative;
+        if (compress) {
+            target += HUFF_EXTENSION;
+        } else if (target.extension() == HUFF_EXTENSION) {
+            target.replace_extension();
+        }
+        return target;
+    }
+
+    // Tworzy katalog wyniku (watki moga tworzyc te same katalogi naraz).
+    static void create_parent(const std::filesystem::path& output) {
+        std::filesystem::path parent = output.parent_path();
+        if (parent.empty()) return;
+        std::error_code error;
+        std::filesystem::create_directories(parent, error);
+        if (!std::filesystem::is_directory(parent)) {
+            throw std::runtime_error("Nie mozna utworzyc katalogu wyjsciowego");
+        }
+    }
+};
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <vector>
+
+// Odczyt strumienia bitow (najstarszy bit pierwszy) bit po bicie albo po kilka
+// bitow naraz, z pamieci lub ze strumienia czytanego fragmentami. Odczyt za
+// koncem danych rzuca wyjatek.
+class BitReader {
+public:
+    static constexpr std::size_t DEFAULT_CHUNK = 256 * 1024;
+
+    explicit BitReader(std::istream& input, std::size_t chunk_size = DEFAULT_CHUNK)
+        : in(&input), buffer(chunk_size == 0 ? 1 : chunk_size) {}
+
+    BitReader(const std::uint8_t* payload, std::size_t payload_size) : data(payload), size(payload_size) {}
+
+    // Zwraca kolejny bit.
+    unsigned bit() {
+        if (available == 0) refill();
+        unsigned result = static_cast<unsigned>(bits >> 63);
+        bits <<= 1;
+        available--;
+        return result;
+    }
+
+    // Zwraca `count` (0-57) kolejnych bitow jako liczbe.
+    std::uint64_t read(unsigned count) {
+        if (count == 0) return 0;
+        while (available < count) refill();
+        std::uint64_t result = bits >> (64 - count);
+        bits <<= count;
+        available -= count;
+        return result;
+    }
+
+    // Liczba bitow przeczytanych dotad przez bit() i read().
+    std::uint64_t bits_read() const {
+        return loaded * 8 - available;
+    }
+
+private:
+    std::istream* in = nullptr;
+    std::vector<std::uint8_t> buffer;
+    const std::uint8_t* data = nullptr;
+    std::size_t size = 0;
+    std::size_t pos = 0;
+    std::uint64_t bits = 0;
+    unsigned available = 0;
+    std::uint64_t loaded = 0;
+
+    // Dokleja do bufora bitow kolejne bajty danych (co najmniej jeden).
+    void refill() {
+        if (pos == size) {
+            if (!in) throw std::runtime_error("Niepoprawny koniec pliku");
+            in->read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+            if (in->bad()) throw std::runtime_error("Wystąpił błąd odczytu pliku.");
+            data = buffer.data();
+            size = static_cast<std::size_t>(in->gcount());
+            pos = 0;
+            if (size == 0) throw std::runtime_error("Niepoprawny koniec pliku");
+        }
+        while (available <= 56 && pos < size) {
+            bits |= static_cast<std::uint64_t>(data[pos++]) << (56 - available);
+            available += 8;
+            loaded++;
+        }
+    }
+};
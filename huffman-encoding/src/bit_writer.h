@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <vector>
+
+// Zapis strumienia bitow (najstarszy bit pierwszy) przez 64-bitowy akumulator.
+// Pelne slowa trafiaja do duzego bufora, a bufor do strumienia wyjsciowego
+// albo na koniec wektora w pamieci. Mozna tez pisac wprost do podanej pamieci
+// o stalej pojemnosci - wtedy BitWriter nie alokuje bufora.
+class BitWriter {
+public:
+    static constexpr std::size_t DEFAULT_BUFFER = 1 << 20;
+
+    explicit BitWriter(std::ostream& output, std::size_t buffer_size = DEFAULT_BUFFER)
+        : out(&output), buffer((buffer_size + 7) / 8 * 8) {
+        if (buffer.empty()) buffer.resize(8);
+    }
+
+    explicit BitWriter(std::vector<std::uint8_t>& target, std::size_t buffer_size = DEFAULT_BUFFER)
+        : memory(&target), buffer((buffer_size + 7) / 8 * 8) {
+        if (buffer.empty()) buffer.resize(8);
+    }
+
+    // Zapis do `capacity` bajtow pod `target`; przepelnienie rzuca wyjatek.
+    BitWriter(std::uint8_t* target, std::size_t capacity) : direct(target), direct_capacity(capacity) {}
+
+    // Dopisuje `length` (1-64) najmlodszych bitow `bits`.
+    void put(std::uint64_t bits, unsigned length) {
+        if (count + length < 64) {
+            accumulator = (accumulator << length) | bits;
+            count += length;
+            return;
+        }
+        unsigned rest = count + length - 64;
+        std::uint64_t word = count == 0 ? bits : (accumulator << (64 - count)) | (bits >> rest);
+        store_word(word);
+        accumulator = rest == 0 ? 0 : bits & ((std::uint64_t{1} << rest) - 1);
+        count = rest;
+    }
+
+    // Konczy strumien: dopelnia ostatni bajt zerami, oproznia bufor
+    // i zwraca liczbe bitow dopelnienia (0-7).
+    std::uint8_t finish() {
+        std::uint8_t padding = static_cast<std::uint8_t>((8 - count % 8) % 8);
+        if (count != 0) {
+            std::uint64_t word = accumulator << (64 - count);
+            unsigned bytes = (count + 7) / 8;
+            std::uint8_t* p = reserve(bytes);
+            for (unsigned i = 0; i < bytes; ++i) {
+                p[i] = static_cast<std::uint8_t>(word >> (56 - 8 * i));
+            }
+            used += bytes;
+        }
+        accumulator = 0;
+        count = 0;
+        flush();
+        return padding;
+    }
+
+    // Liczba bajtow przekazanych juz do strumienia lub wektora (albo zapisanych do pamieci).
+    std::uint64_t bytes_written() const {
+        return written;
+    }
+
+private:
+    std::ostream* out = nullptr;
+    std::vector<std::uint8_t>* memory = nullptr;
+    std::uint8_t* direct = nullptr;
+    std::size_t direct_capacity = 0;
+    std::vector<std::uint8_t> buffer;
+    std::size_t used = 0;
+    std::uint64_t written = 0;
+    std::uint64_t accumulator = 0;
+    unsigned count = 0;
+
+    // Zapisuje slowo w kolejnosci big-endian do bufora.
+    void store_word(std::uint64_t word) {
+        std::uint8_t* p = reserve(8);
+        for (int i = 0; i < 8; ++i) {
+            p[i] = static_cast<std::uint8_t>(word >> (56 - 8 * i));
+        }
+        used += 8;
+    }
+
+    // Zwraca miejsce na `bytes` kolejnych bajtow, w razie potrzeby oprozniajac bufor.
+    std::uint8_t* reserve(std::size_t bytes) {
+        if (direct) {
+            if (direct_capacity - used < bytes) throw std::runtime_error("Za maly bufor wyjsciowy");
+            return direct + used;
+        }
+        if (buffer.size() - used < bytes) flush();
+        return buffer.data() + used;
+    }
+
+    // Przekazuje zawartosc bufora do strumienia lub wektora.
+    void flush() {
+        if (used == 0) return;
+        if (direct) {
+            // Dane sa juz na miejscu - przesuwamy tylko poczatek wolnej pamieci.
+            direct += used;
+            direct_capacity -= used;
+        } else if (memory) {
+            memory->insert(memory->end(), buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(used));
+        } else {
+            out->write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(used));
+            if (!*out) throw std::runtime_error("Blad zapisu pliku wyjsciowego");
+        }
+        written += used;
+        used = 0;
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "huffman_code.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+// Zliczanie bajtow do plaskiego histogramu. Kolejne bajty trafiaja do kilku
+// niezaleznych podhistogramow, zeby inkrementacje tego samego licznika nie
+// czekaly na siebie (zapis-odczyt tej samej komorki), a na koncu sa sumowane.
+class ByteCounter {
+public:
+    // Ponizej tej wielkosci dodatkowe watki nie sa uruchamiane.
+    static constexpr std::size_t PARALLEL_MIN_SIZE = 4 * 1024 * 1024;
+
+    // Dolicza wystapienia bajtow z `data` do `histogram`.
+    static void count(const std::uint8_t* data, std::size_t size, ByteHistogram& histogram) {
+        // Podhistogramy sa 32-bitowe (mniej pamieci podrecznej), wiec dane dzielimy
+        // na fragmenty, ktore ich nie przepelnia; wynik jest 64-bitowy.
+        while (size > 0) {
+            std::size_t n = std::min(size, MAX_CHUNK);
+            count_chunk(data, n, histogram);
+            data += n;
+            size -= n;
+        }
+    }
+
+    // Zlicza bajty na `threads` watkach - kazdy liczy swoj fragment do osobnej
+    // tablicy, a wyniki sa na koncu sumowane.
+    static ByteHistogram count_parallel(const std::uint8_t* data, std::size_t size, unsigned threads) {
+        ByteHistogram histogram{};
+        if (threads <= 1 || size < PARALLEL_MIN_SIZE) {
+            count(data, size, histogram);
+            return histogram;
+        }
+
+        std::vector<ByteHistogram> partial(threads, ByteHistogram{});
+        std::vector<std::thread> workers;
+        std::size_t slice = (size + threads - 1) / threads;
+        for (unsigned t = 1; t < threads; ++t) {
+            std::size_t begin = std::min(size, t * slice);
+            std::size_t end = std::min(size, begin + slice);
+            workers.emplace_back([&partial, data, begin, end, t]() { count(data + begin, end - begin, partial[t]); });
+        }
+        count(data, std::min(size, slice), partial[0]);
+        for (std::thread& worker : workers) worker.join();
+
+        for (const ByteHistogram& part : partial) merge(histogram, part);
+        return histogram;
+    }
+
+    // Entropia Shannona licznikow `counts[0..size)` w bitach (suma c * log2(n / c)):
+    // zaden kod prefiksowy nie zakoduje tych danych krocej.
+    template <typename Count>
+    static double entropy_bits(const Count* counts, std::size_t size) {
+        std::uint64_t total = 0;
+        for (std::size_t s = 0; s < size; ++s) total += counts[s];
+        double bits = 0.0;
+        for (std::size_t s = 0; s < size; ++s) {
+            if (counts[s] != 0) bits += static_cast<double>(counts[s]) * std::log2(static_cast<double>(total) / static_cast<double>(counts[s]));
+        }
+        return bits;
+    }
+
+    // Dodaje `from` do `into`.
+    static void merge(ByteHistogram& into, const ByteHistogram& from) {
+        for (std::size_t s = 0; s < into.size(); ++s) into[s] += from[s];
+    }
+
+private:
+    static constexpr std::size_t LANES = 4;
+    static constexpr std::size_t MAX_CHUNK = std::size_t{1} << 30;
+
+    static void count_chunk(const std::uint8_t* data, std::size_t size, ByteHistogram& histogram) {
+        alignas(64) std::uint32_t lanes[LANES][256] = {};
+
+        std::size_t i = 0;
+        for (; i + 16 <= size; i += 16) {
+            std::uint64_t a;
+            std::uint64_t b;
+            std::memcpy(&a, data + i, sizeof(a));
+            std::memcpy(&b, data + i + 8, sizeof(b));
+            for (unsigned shift = 0; shift < 64; shift += 16) {
+                lanes[0][(a >> shift) & 0xFF]++;
+                lanes[1][(a >> (shift + 8)) & 0xFF]++;
+                lanes[2][(b >> shift) & 0xFF]++;
+                lanes[3][(b >> (shift + 8)) & 0xFF]++;
+            }
+        }
+        for (; i < size; ++i) lanes[0][data[i]]++;
+
+        // Sumowanie podhistogramow kompilator zamienia na instrukcje wektorowe.
+        for (std::size_t s = 0; s < 256; ++s) {
+            histogram[s] += std::uint64_t{lanes[0][s]} + lanes[1][s] + lanes[2][s] + lanes[3][s];
+        }
+    }
+};
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "huffman_code.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+// Kody kanoniczne: kod symbolu wynika wylacznie z dlugosci kodow, wiec plik
+// przechowuje tylko dlugosci, a koder i dekoder odtwarzaja z nich te same kody.
+class CanonicalCodes {
+public:
+    static constexpr unsigned MAX_LENGTH = 63;
+
+    // Wyciaga dlugosci z dowolnej tablicy kodow (np. z drzewa).
+    static CodeLengths lengths_of(const CodeTable& codes) {
+        CodeLengths lengths{};
+        for (size_t s = 0; s < codes.size(); ++s) {
+            if (codes[s].length > MAX_LENGTH) throw std::runtime_error("Zbyt dlugi kod Huffmana");
+            lengths[s] = codes[s].length;
+        }
+        return lengths;
+    }
+
+    // Nadaje kody kanoniczne: krotsze kody pierwsze, przy rownej dlugosci mniejszy bajt.
+    static CodeTable from_lengths(const CodeLengths& lengths) {
+        std::uint64_t count[MAX_LENGTH + 1] = {};
+        for (std::uint8_t length : lengths) {
+            if (length > MAX_LENGTH) throw std::runtime_error("Niepoprawna dlugosc kodu");
+            count[length]++;
+        }
+        count[0] = 0;
+
+        std::uint64_t next_code[MAX_LENGTH + 1] = {};
+        std::uint64_t code = 0;
+        for (unsigned length = 1; length <= MAX_LENGTH; ++length) {
+            code = (code + count[length - 1]) << 1;
+            next_code[length] = code;
+            if (count[length] > (std::uint64_t{1} << length) - code) {
+                throw std::runtime_error("Niepoprawne dlugosci kodow (nadmiarowe kody)");
+            }
+        }
+
+        CodeTable codes{};
+        for (size_t s = 0; s < lengths.size(); ++s) {
+            if (lengths[s] == 0) continue;
+            codes[s] = HuffmanCode{next_code[lengths[s]]++, lengths[s]};
+        }
+        return codes;
+    }
+};
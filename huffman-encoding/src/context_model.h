@@ -0,0 +1,328 @@
+#pragma once
+
+#include "bit_writer.h"
+#include "canonical_codes.h"
+#include "huff_format.h"
+#include "huffman_tree.h"
+#include "length_limited_codes.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Model rzedu 1: kody bajtu zaleza od poprzedniego bajtu (kontekstu). Zeby naglowek
+// bloku i tablice dekodera pozostaly male, konteksty o podobnych rozkladach sa
+// laczone w co najwyzej ContextTables::MAX_CLUSTERS grup ze wspolnymi kodami.
+// Grupy sa wyznaczane jak w k-means: ziarna to konteksty najgorzej kodowane przez
+// dotychczasowe grupy, a potem konteksty sa kilka razy przypisywane do grupy, ktora
+// koduje je najtaniej. Liczba grup (1, 2, 4, 8 albo 16) rosnie, dopoki maleje suma
+// szacowanych danych i naglowka - jedna grupa to model rzedu 0.
+class ContextModel {
+public:
+    // Liczniki par (poprzedni bajt, bajt): CONTEXT_COUNTS liczb, indeks = poprzedni * 256 + bajt.
+    static constexpr std::size_t CONTEXT_COUNTS = 256 * 256;
+    // Szerokosc tablic dekodujacych grup - mniejsza niz dla jednej tablicy, zeby
+    // wszystkie grupy naraz miescily sie w pamieci podrecznej.
+    static constexpr unsigned TABLE_BITS = 8;
+
+    // Zlicza pary (poprzedni bajt, bajt) bloku do `counts` (CONTEXT_COUNTS liczb).
+    static void count(const std::uint8_t* data, std::size_t size, std::uint32_t* counts) {
+        std::fill(counts, counts + CONTEXT_COUNTS, 0u);
+        std::size_t previous = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            counts[(previous << 8) | data[i]]++;
+            previous = data[i];
+        }
+    }
+
+    using Symbol = std::pair<std::uint8_t, std::uint32_t>;
+
+    // Kontekst, ktory wystapil w bloku: bajty po nim (tylko niezerowe liczniki)
+    // jako zakres wspolnej tablicy wszystkich kontekstow.
+    struct Context {
+        std::uint8_t byte = 0;
+        std::uint64_t total = 0;
+        const Symbol* first = nullptr;
+        const Symbol* last = nullptr;
+
+        const Symbol* begin() const { return first; }
+        const Symbol* end() const { return last; }
+    };
+
+    // Koszt symboli w grupie w bitach (-log2 prawdopodobienstwa), liczony raz na
+    // przypisanie. Liczniki sa wygladzane o pol wystapienia, zeby symbol nieobecny
+    // w grupie mial skonczony, ale wysoki koszt.
+    struct ClusterCost {
+        std::array<double, 256> bits;
+
+        explicit ClusterCost(const ByteHistogram& cluster) {
+            double total = 128.0;
+            for (std::uint64_t count : cluster) total += static_cast<double>(count);
+            for (unsigned s = 0; s < 256; ++s) bits[s] = std::log2(total / (static_cast<double>(cluster[s]) + 0.5));
+        }
+    };
+
+    // Pamiec build do ponownego uzycia (np. w HuffContext): po pierwszym wywolaniu
+    // kolejne wywolania z tymi samymi buforami nie alokuja.
+    struct Buffers {
+        std::vector<Symbol> symbols;
+        std::vector<Context> contexts;
+        std::vector<std::uint8_t> seeds;
+        std::vector<double> own;
+        std::vector<double> loss;
+        std::vector<ByteHistogram> clusters;
+        std::vector<ByteHistogram> best_clusters;
+        std::vector<std::uint64_t> totals;
+        std::vector<std::size_t> member;
+        std::vector<ClusterCost> costs;
+        std::vector<std::size_t> renumber;
+        LengthLimitedCodes::Buffers package_merge;
+    };
+
+    // Wyznacza grupy kontekstow i dlugosci kodow grup. `unlimited_bits` dostaje rozmiar
+    // danych przy kodach bez ograniczenia dlugosci (`max_code_length`, 0 - bez ograniczenia).
+    static ContextTables build(const std::uint32_t* counts, unsigned max_code_length, std::uint64_t& unlimited_bits,
+                               Buffers& buffers) {
+        collect(counts, buffers);
+        pick_seeds(buffers);
+
+        ContextTables best;
+        double best_cost = std::numeric_limits<double>::infinity();
+        buffers.clusters.reserve(ContextTables::MAX_CLUSTERS);
+        buffers.best_clusters.reserve(ContextTables::MAX_CLUSTERS);
+        buffers.best_clusters.clear();
+        for (std::size_t k = 1; k <= buffers.seeds.size(); k *= 2) {
+            CodeLengths cluster_of = assign(buffers, k);
+            double cost = estimated_bits(buffers.clusters, cluster_of);
+            // Wiecej grup juz sie nie oplaca (np. dane bez zaleznosci miedzy bajtami).
+            if (cost >= best_cost) break;
+            best_cost = cost;
+            best.count = static_cast<unsigned>(buffers.clusters.size());
+            best.cluster_of = cluster_of;
+            std::swap(buffers.clusters, buffers.best_clusters);
+        }
+
+        unlimited_bits = 0;
+        for (unsigned c = 0; c < best.count; ++c) {
+            const ByteHistogram& cluster = buffers.best_clusters[c];
+            CodeLengths& lengths = best.lengths[c];
+            lengths = CanonicalCodes::lengths_of(HuffmanTree::from_frequencies(cluster).build_huffman_codes());
+            unlimited_bits += LengthLimitedCodes::encoded_bits(cluster, lengths);
+            if (max_code_length != 0 && LengthLimitedCodes::longest(lengths) > max_code_length) {
+                lengths = LengthLimitedCodes::build(cluster, max_code_length, buffers.package_merge);
+            }
+        }
+        return best;
+    }
+
+    // Rozmiar danych bloku w bitach przy podanych tablicach.
+    static std::uint64_t encoded_bits(const std::uint32_t* counts, const ContextTables& tables) {
+        std::uint64_t bits = 0;
+        for (unsigned context = 0; context < 256; ++context) {
+            const CodeLengths& lengths = tables.lengths[tables.cluster_of[context]];
+            const std::uint32_t* row = counts + (context << 8);
+            for (unsigned s = 0; s < 256; ++s) bits += static_cast<std::uint64_t>(row[s]) * lengths[s];
+        }
+        return bits;
+    }
+
+    // Najdluzszy kod wszystkich grup.
+    static unsigned longest(const ContextTables& tables) {
+        unsigned longest = 0;
+        for (unsigned c = 0; c < tables.count; ++c) {
+            longest = std::max(longest, LengthLimitedCodes::longest(tables.lengths[c]));
+        }
+        return longest;
+    }
+
+    // Koduje dane kodami grup (`codes[c]` - kody grupy c) i zwraca liczbe bitow dopelnienia.
+    static std::uint8_t write_bits(const std::uint8_t* data, std::size_t size, const CodeTable* codes,
+                                   const CodeLengths& cluster_of, BitWriter& writer) {
+        std::uint8_t previous = 0;
+        for (std::size_t i = 0; i < size; ++i) {
+            const HuffmanCode& code = codes[cluster_of[previous]][data[i]];
+            if (code.length == 0) {
+                throw std::runtime_error("Brak kodu Huffmana dla bajtu");
+            }
+            writer.put(code.bits, code.length);
+            previous = data[i];
+        }
+        return writer.finish();
+    }
+
+private:
+    // Liczba przypisan kontekstow do grup po wybraniu ziaren.
+    static constexpr unsigned REFINE_ROUNDS = 4;
+
+    // Zbiera konteksty bloku do `buffers.contexts`; `buffers.symbols` przechowuje ich liczniki.
+    static void collect(const std::uint32_t* counts, Buffers& buffers) {
+        std::vector<Symbol>& symbols = buffers.symbols;
+        std::vector<Context>& contexts = buffers.contexts;
+        // Pelna pojemnosc z gory - konteksty wskazuja na elementy `symbols`.
+        symbols.reserve(CONTEXT_COUNTS);
+        symbols.clear();
+        contexts.reserve(256);
+        contexts.clear();
+        for (unsigned context = 0; context < 256; ++context) {
+            const std::uint32_t* row = counts + (context << 8);
+            Context c;
+            c.byte = static_cast<std::uint8_t>(context);
+            c.first = symbols.data() + symbols.size();
+            for (unsigned s = 0; s < 256; ++s) {
+                if (row[s] == 0) continue;
+                symbols.emplace_back(static_cast<std::uint8_t>(s), row[s]);
+                c.total += row[s];
+            }
+            c.last = symbols.data() + symbols.size();
+            if (c.total != 0) contexts.push_back(c);
+        }
+    }
+
+    // Koszt w bitach kodowania kontekstu rozkladem grupy.
+    static double cost(const Context& context, const ClusterCost& cluster) {
+        double bits = 0.0;
+        for (const Symbol& symbol : context) bits += static_cast<double>(symbol.second) * cluster.bits[symbol.first];
+        return bits;
+    }
+
+    // Entropia rozkladu w bitach (suma c * log2(n / c)).
+    static double entropy(const ByteHistogram& histogram) {
+        std::uint64_t total = 0;
+        for (std::uint64_t count : histogram) total += count;
+        double bits = 0.0;
+        for (std::uint64_t count : histogram) {
+            if (count != 0) bits += static_cast<double>(count) * std::log2(static_cast<double>(total) / static_cast<double>(count));
+        }
+        return bits;
+    }
+
+    static ByteHistogram histogram_of(const Context& context) {
+        ByteHistogram histogram{};
+        for (const Symbol& symbol : context) histogram[symbol.first] = symbol.second;
+        return histogram;
+    }
+
+    // Wybiera do MAX_CLUSTERS ziaren (indeksy w `buffers.contexts`) do `buffers.seeds`:
+    // najczestszy kontekst, a potem kolejno kontekst, ktory ziarna wybrane dotad koduja
+    // najgorzej w stosunku do jego wlasnego rozkladu.
+    static void pick_seeds(Buffers& buffers) {
+        const std::vector<Context>& contexts = buffers.contexts;
+        std::vector<std::uint8_t>& seeds = buffers.seeds;
+        seeds.reserve(ContextTables::MAX_CLUSTERS);
+        seeds.clear();
+        if (contexts.empty()) return;
+        std::size_t first = 0;
+        for (std::size_t i = 1; i < contexts.size(); ++i) {
+            if (contexts[i].total > contexts[first].total) first = i;
+        }
+        seeds.push_back(static_cast<std::uint8_t>(first));
+
+        std::vector<double>& own = buffers.own;
+        std::vector<double>& loss = buffers.loss;
+        own.reserve(256);
+        loss.reserve(256);
+        own.resize(contexts.size());
+        loss.assign(contexts.size(), std::numeric_limits<double>::infinity());
+        for (std::size_t i = 0; i < contexts.size(); ++i) own[i] = entropy(histogram_of(contexts[i]));
+        while (seeds.size() < std::min<std::size_t>(ContextTables::MAX_CLUSTERS, contexts.size())) {
+            const Context& seed = contexts[seeds.back()];
+            const ClusterCost seed_cost(histogram_of(seed));
+            std::size_t worst = 0;
+            for (std::size_t i = 0; i < contexts.size(); ++i) {
+                loss[i] = std::min(loss[i], cost(contexts[i], seed_cost) - own[i]);
+                if (loss[i] > loss[worst]) worst = i;
+            }
+            if (loss[worst] <= 0.0) break;
+            seeds.push_back(static_cast<std::uint8_t>(worst));
+        }
+    }
+
+    // Przypisuje konteksty do `k` grup zaczynajacych sie od pierwszych `k` ziaren.
+    // Zwraca grupe kazdego bajtu kontekstu; `buffers.clusters` dostaje histogramy
+    // niepustych grup.
+    static CodeLengths assign(Buffers& buffers, std::size_t k) {
+        const std::vector<Context>& contexts = buffers.contexts;
+        const std::vector<std::uint8_t>& seeds = buffers.seeds;
+        std::vector<ByteHistogram>& clusters = buffers.clusters;
+        std::vector<std::uint64_t>& totals = buffers.totals;
+        std::vector<std::size_t>& member = buffers.member;
+        std::vector<ClusterCost>& costs = buffers.costs;
+        totals.reserve(ContextTables::MAX_CLUSTERS);
+        member.reserve(256);
+        costs.reserve(ContextTables::MAX_CLUSTERS);
+        clusters.assign(k, ByteHistogram{});
+        totals.assign(k, 0);
+        member.assign(contexts.size(), k);
+        for (std::size_t c = 0; c < k; ++c) {
+            clusters[c] = histogram_of(contexts[seeds[c]]);
+            totals[c] = contexts[seeds[c]].total;
+            member[seeds[c]] = c;
+        }
+
+        for (unsigned round = 0; round < REFINE_ROUNDS; ++round) {
+            costs.clear();
+            for (std::size_t c = 0; c < k; ++c) costs.emplace_back(clusters[c]);
+            for (std::size_t i = 0; i < contexts.size(); ++i) {
+                std::size_t best = 0;
+                double best_bits = std::numeric_limits<double>::infinity();
+                for (std::size_t c = 0; c < k; ++c) {
+                    if (totals[c] == 0) continue;
+                    double bits = cost(contexts[i], costs[c]);
+                    if (bits < best_bits) {
+                        best_bits = bits;
+                        best = c;
+                    }
+                }
+                member[i] = best;
+            }
+            // Histogramy grup od nowa z przypisanych kontekstow.
+            std::fill(clusters.begin(), clusters.end(), ByteHistogram{});
+            std::fill(totals.begin(), totals.end(), 0);
+            for (std::size_t i = 0; i < contexts.size(); ++i) {
+                for (const Symbol& symbol : contexts[i]) clusters[member[i]][symbol.first] += symbol.second;
+                totals[member[i]] += contexts[i].total;
+            }
+        }
+
+        // Pomija puste grupy i numeruje pozostale po kolei.
+        std::vector<std::size_t>& renumber = buffers.renumber;
+        renumber.reserve(ContextTables::MAX_CLUSTERS);
+        renumber.assign(k, 0);
+        std::size_t used = 0;
+        for (std::size_t c = 0; c < k; ++c) {
+            if (totals[c] == 0) continue;
+            renumber[c] = used;
+            clusters[used++] = clusters[c];
+        }
+        clusters.resize(used);
+        CodeLengths cluster_of{};
+        for (std::size_t i = 0; i < contexts.size(); ++i) {
+            cluster_of[contexts[i].byte] = static_cast<std::uint8_t>(renumber[member[i]]);
+        }
+        return cluster_of;
+    }
+
+    // Szacowany rozmiar bloku w bitach: entropia grup i naglowek (mapa kontekstow
+    // i dlugosci kodow, po bajcie na uzyty symbol i serie nieuzywanych).
+    static double estimated_bits(const std::vector<ByteHistogram>& clusters, const CodeLengths& cluster_of) {
+        std::array<std::uint8_t, HuffFormat::MAX_CODE_LENGTHS_SIZE> header;
+        std::uint8_t* end = header.data();
+        if (clusters.size() > 1) HuffFormat::write_code_lengths(end, header.data() + header.size(), cluster_of);
+        double bits = static_cast<double>(1 + (end - header.data())) * 8.0;
+        for (const ByteHistogram& cluster : clusters) {
+            bits += entropy(cluster);
+            unsigned table_bytes = 0;
+            for (unsigned s = 0; s < 256; ++s) {
+                if (cluster[s] != 0 || s == 0 || cluster[s - 1] != 0) table_bytes++;
+            }
+            bits += 8.0 * table_bytes;
+        }
+        return bits;
+    }
+};
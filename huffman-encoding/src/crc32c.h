@@ -0,0 +1,202 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define HUFF_CRC32C_X86 1
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(HUFF_CRC32C_X86) && (defined(__GNUC__) || defined(__clang__))
+#define HUFF_TARGET_SSE42 __attribute__((target("sse4.2")))
+#else
+#define HUFF_TARGET_SSE42
+#endif
+
+// Suma kontrolna CRC-32C (wielomian Castagnoli) danych blokow. Na procesorach x86
+// z SSE4.2 liczy ja instrukcja crc32 (8 bajtow na instrukcje) w trzech przeplatanych
+// strumieniach, laczonych tablicami przesuniecia; w pozostalych przypadkach tablicami
+// slice-by-8. Implementacja jest wybierana raz, przy pierwszym wywolaniu, wiec
+// program dziala takze bez SSE4.2.
+class Crc32c {
+public:
+    // Suma kontrolna `size` bajtow.
+    static std::uint32_t compute(const std::uint8_t* data, std::size_t size) {
+        return update(0, data, size);
+    }
+
+    // Dolicza `size` bajtow do sumy `crc` (wynik poprzedniego wywolania albo 0
+    // na poczatku danych), wiec dane moga byc liczone fragmentami.
+    static std::uint32_t update(std::uint32_t crc, const std::uint8_t* data, std::size_t size) {
+        static const Update implementation = hardware_available() ? update_sse42 : update_slice8;
+        return ~implementation(~crc, data, size);
+    }
+
+    // To samo tablicami slice-by-8, niezaleznie od procesora (dla huff_bench).
+    static std::uint32_t update_portable(std::uint32_t crc, const std::uint8_t* data, std::size_t size) {
+        return ~update_slice8(~crc, data, size);
+    }
+
+    // Czy procesor ma instrukcje crc32 (SSE4.2).
+    static bool hardware_available() {
+#if defined(HUFF_CRC32C_X86) && defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 20)) != 0;
+#elif defined(HUFF_CRC32C_X86)
+        return __builtin_cpu_supports("sse4.2");
+#else
+        return false;
+#endif
+    }
+
+private:
+    using Update = std::uint32_t (*)(std::uint32_t, const std::uint8_t*, std::size_t);
+    using Tables = std::array<std::array<std::uint32_t, 256>, 8>;
+
+    // Wielomian Castagnoli w zapisie odwroconym.
+    static constexpr std::uint32_t POLYNOMIAL = 0x82F63B78u;
+
+    // tables[0] - reszta dla jednego bajtu; tables[k] - dla bajtu, po ktorym jest jeszcze k bajtow.
+    static const Tables& tables() {
+        static const Tables value = [] {
+            Tables t{};
+            for (std::uint32_t i = 0; i < 256; ++i) {
+                std::uint32_t crc = i;
+                for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (POLYNOMIAL & (0u - (crc & 1)));
+                t[0][i] = crc;
+            }
+            for (std::size_t k = 1; k < t.size(); ++k) {
+                for (std::size_t i = 0; i < 256; ++i) t[k][i] = (t[k - 1][i] >> 8) ^ t[0][t[k - 1][i] & 0xFF];
+            }
+            return t;
+        }();
+        return value;
+    }
+
+    // Fragmenty liczone naraz w trzech strumieniach: crc32 ma opoznienie 3 cykli, ale
+    // przepustowosc jednej instrukcji na cykl.
+    static constexpr std::size_t LONG_RUN = 8192;
+    static constexpr std::size_t SHORT_RUN = 256;
+
+    // Tablice przesuniecia: shift(crc) to suma `crc` przesunieta o RUN bajtow zerowych.
+    struct ShiftTables {
+        std::array<std::array<std::uint32_t, 256>, 4> long_run;
+        std::array<std::array<std::uint32_t, 256>, 4> short_run;
+    };
+
+    // Mnozenie wektora przez macierz 32x32 nad GF(2) (kolumny w `matrix`).
+    static std::uint32_t gf2_times(const std::uint32_t* matrix, std::uint32_t vector) {
+        std::uint32_t sum = 0;
+        for (; vector != 0; vector >>= 1, ++matrix) {
+            if (vector & 1) sum ^= *matrix;
+        }
+        return sum;
+    }
+
+    static void gf2_square(std::uint32_t* square, const std::uint32_t* matrix) {
+        for (int n = 0; n < 32; ++n) square[n] = gf2_times(matrix, matrix[n]);
+    }
+
+    // Tablice dla operatora dopisania `length` bajtow zerowych (length to potega dwojki).
+    static std::array<std::array<std::uint32_t, 256>, 4> zeros_tables(std::size_t length) {
+        std::uint32_t odd[32];
+        std::uint32_t even[32];
+        // Operator jednego bitu zerowego, potem kolejne kwadraty: 2, 4, 8... bitow.
+        odd[0] = POLYNOMIAL;
+        for (int n = 1; n < 32; ++n) odd[n] = std::uint32_t{1} << (n - 1);
+        gf2_square(even, odd);
+        gf2_square(odd, even);
+        std::uint32_t* op = odd;
+        for (std::size_t bytes = 1; ; bytes <<= 1) {
+            gf2_square(op == odd ? even : odd, op);
+            op = op == odd ? even : odd;
+            if (bytes >= length) break;
+        }
+        std::array<std::array<std::uint32_t, 256>, 4> t{};
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            for (unsigned k = 0; k < 4; ++k) t[k][n] = gf2_times(op, n << (8 * k));
+        }
+        return t;
+    }
+
+    static const ShiftTables& shift_tables() {
+        static const ShiftTables value{zeros_tables(LONG_RUN), zeros_tables(SHORT_RUN)};
+        return value;
+    }
+
+    static std::uint32_t shift(const std::array<std::array<std::uint32_t, 256>, 4>& t, std::uint32_t crc) {
+        return t[0][crc & 0xFF] ^ t[1][(crc >> 8) & 0xFF] ^ t[2][(crc >> 16) & 0xFF] ^ t[3][crc >> 24];
+    }
+
+    static std::uint32_t load_le32(const std::uint8_t* p) {
+        return static_cast<std::uint32_t>(p[0]) | static_cast<std::uint32_t>(p[1]) << 8
+            | static_cast<std::uint32_t>(p[2]) << 16 | static_cast<std::uint32_t>(p[3]) << 24;
+    }
+
+    static std::uint32_t update_slice8(std::uint32_t crc, const std::uint8_t* data, std::size_t size) {
+        const Tables& t = tables();
+        while (size >= 8) {
+            std::uint32_t low = crc ^ load_le32(data);
+            std::uint32_t high = load_le32(data + 4);
+            crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24]
+                ^ t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+            data += 8;
+            size -= 8;
+        }
+        while (size-- > 0) crc = (crc >> 8) ^ t[0][(crc ^ *data++) & 0xFF];
+        return crc;
+    }
+
+#if defined(HUFF_CRC32C_X86)
+    HUFF_TARGET_SSE42 static std::uint64_t crc32_word(std::uint64_t crc, const std::uint8_t* data) {
+        std::uint64_t word;
+        std::memcpy(&word, data, sizeof(word));
+        return _mm_crc32_u64(crc, word);
+    }
+
+    // Trzy sasiednie fragmenty po `run` bajtow sa liczone naraz, a ich sumy laczone
+    // przesunieciem: crc(A B) = shift(crc(A)) ^ crc(B) dla B liczonego od zera.
+    HUFF_TARGET_SSE42 static std::uint64_t update_runs(std::uint64_t crc, const std::uint8_t*& data, std::size_t& size,
+                                                       std::size_t run,
+                                                       const std::array<std::array<std::uint32_t, 256>, 4>& t) {
+        while (size >= 3 * run) {
+            std::uint64_t crc1 = 0;
+            std::uint64_t crc2 = 0;
+            for (const std::uint8_t* end = data + run; data < end; data += 8) {
+                crc = crc32_word(crc, data);
+                crc1 = crc32_word(crc1, data + run);
+                crc2 = crc32_word(crc2, data + 2 * run);
+            }
+            crc = shift(t, static_cast<std::uint32_t>(crc)) ^ crc1;
+            crc = shift(t, static_cast<std::uint32_t>(crc)) ^ crc2;
+            data += 2 * run;
+            size -= 3 * run;
+        }
+        return crc;
+    }
+
+    HUFF_TARGET_SSE42 static std::uint32_t update_sse42(std::uint32_t crc, const std::uint8_t* data, std::size_t size) {
+        std::uint64_t value = crc;
+        if (size >= 3 * SHORT_RUN) {
+            const ShiftTables& t = shift_tables();
+            value = update_runs(value, data, size, LONG_RUN, t.long_run);
+            value = update_runs(value, data, size, SHORT_RUN, t.short_run);
+        }
+        for (; size >= 8; data += 8, size -= 8) value = crc32_word(value, data);
+        std::uint32_t result = static_cast<std::uint32_t>(value);
+        while (size-- > 0) result = _mm_crc32_u8(result, *data++);
+        return result;
+    }
+#else
+    static std::uint32_t update_sse42(std::uint32_t crc, const std::uint8_t* data, std::size_t size) {
+        return update_slice8(crc, data, size);
+    }
+#endif
+};
@@ -0,0 +1,486 @@
+#pragma once
+
+#include "crc32c.h"
+#include "huffman_code.h"
+#include "payload_source.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Tablicowy dekoder Huffmana: podglada `root_bits` bitow naraz i rozwiazuje
+// jednym odczytem do trzech krotkich symboli. Kody dluzsze od `root_bits`
+// trafiaja do podtablic kolejnych poziomow.
+class DecodeTable {
+public:
+    static constexpr unsigned DEFAULT_BITS = 11;
+    static constexpr unsigned MIN_BITS = 4;
+    static constexpr unsigned MAX_BITS = 15;
+    static constexpr unsigned MAX_STREAMS = 8;
+
+    // Buduje tablice z kodow symboli.
+    explicit DecodeTable(const CodeTable& codes, unsigned table_bits = DEFAULT_BITS) {
+        rebuild(codes, table_bits);
+    }
+
+    // Buduje tablice od nowa dla innych kodow. Pamiec poprzedniej tablicy jest
+    // uzywana ponownie, wiec przy podobnych kodach przebudowa nie alokuje.
+    void rebuild(const CodeTable& codes, unsigned table_bits = DEFAULT_BITS) {
+        if (table_bits < MIN_BITS || table_bits > MAX_BITS) {
+            throw std::runtime_error("Niepoprawna szerokosc tablicy dekodujacej");
+        }
+        root_bits = table_bits;
+
+        symbol_count = 0;
+        longest = 0;
+        for (unsigned s = 0; s < codes.size(); ++s) {
+            if (codes[s].length == 0) continue;
+            if (codes[s].length > 64) throw std::runtime_error("Zbyt dlugi kod Huffmana");
+            longest = std::max(longest, static_cast<unsigned>(codes[s].length));
+            // Kod wyrownany do najstarszego bitu - kody o wspolnym prefiksie leza obok siebie po sortowaniu.
+            symbols[symbol_count++] = Symbol{codes[s].bits << (64 - codes[s].length), codes[s].length,
+                                             static_cast<std::uint8_t>(s)};
+        }
+        std::sort(symbols.begin(), symbols.begin() + static_cast<std::ptrdiff_t>(symbol_count),
+                  [](const Symbol& a, const Symbol& b) { return a.code < b.code; });
+
+        entries.assign(std::size_t{1} << root_bits, Entry{});
+        fill_level(0, root_bits, 0, 0, symbol_count);
+        merge_short_symbols();
+    }
+
+    // Dekoduje dane pobierane ze zrodla fragmentami (patrz payload_source.h)
+    // i zapisuje bajty do strumienia paczkami po OUT_CHUNK. Z `checksum` kazda paczka
+    // jest przed zapisem doliczana do sumy CRC-32C. Zwraca liczbe bajtow.
+    template <typename Source>
+    std::uint64_t decode(Source& source, std::ostream& out, std::uint32_t* checksum = nullptr) const {
+        StreamSink sink(out, checksum);
+        return decode_to(source, sink);
+    }
+
+    // Dekoduje dane do pamieci `out` o pojemnosci `capacity` bajtow (bez alokacji).
+    // Zwraca liczbe bajtow; gdy wynik sie nie miesci, rzuca wyjatek.
+    template <typename Source>
+    std::uint64_t decode(Source& source, std::uint8_t* out, std::size_t capacity) const {
+        MemorySink sink(out, capacity);
+        return decode_to(source, sink);
+    }
+
+    // Dekoduje `symbol_count` symboli rozlozonych na przemian miedzy `stream_count`
+    // niezaleznych strumieni (symbol i trafil do strumienia i % stream_count).
+    // Strumienie sa dekodowane w jednej petli, wiec odczyty tablicy dla roznych
+    // strumieni nie czekaja na siebie. Wynik trafia do `out` (symbol_count bajtow).
+    void decode_interleaved(const std::uint8_t* const* streams, const std::size_t* sizes, unsigned stream_count,
+                            std::uint64_t symbol_count, std::uint8_t* out) const {
+        static_assert(MAX_STREAMS == 8, "decode_interleaved obsluguje 1-8 strumieni");
+        switch (stream_count) {
+            case 1: decode_streams<1>(streams, sizes, symbol_count, out); return;
+            case 2: decode_streams<2>(streams, sizes, symbol_count, out); return;
+            case 3: decode_streams<3>(streams, sizes, symbol_count, out); return;
+            case 4: decode_streams<4>(streams, sizes, symbol_count, out); return;
+            case 5: decode_streams<5>(streams, sizes, symbol_count, out); return;
+            case 6: decode_streams<6>(streams, sizes, symbol_count, out); return;
+            case 7: decode_streams<7>(streams, sizes, symbol_count, out); return;
+            case 8: decode_streams<8>(streams, sizes, symbol_count, out); return;
+            default: throw std::runtime_error("Niepoprawna liczba strumieni");
+        }
+    }
+
+    // Dekoduje `symbol_count` symboli modelu rzedu 1: kazdy symbol jest dekodowany
+    // tablica `tables[cluster_of[poprzedni bajt]]` (przed pierwszym symbolem
+    // poprzedni bajt to 0). Dane musza miec dokladnie `bit_count` bitow.
+    static void decode_context(const DecodeTable* tables, const std::uint8_t* cluster_of, const std::uint8_t* payload,
+                               std::size_t size, std::uint64_t bit_count, std::uint64_t symbol_count,
+                               std::uint8_t* out) {
+        // Tablica dla kazdego kontekstu - jeden odczyt mniej na symbol.
+        const DecodeTable* by_context[256];
+        for (unsigned context = 0; context < 256; ++context) by_context[context] = &tables[cluster_of[context]];
+        StreamState state;
+        state.data = payload;
+        state.size = size;
+        std::uint8_t previous = 0;
+        for (std::uint64_t i = 0; i < symbol_count; ++i) {
+            previous = by_context[previous]->decode_symbol(state);
+            out[i] = previous;
+        }
+        if (state.consumed() != bit_count) invalid_data();
+    }
+
+private:
+    static constexpr std::size_t OUT_CHUNK = 64 * 1024;
+    // Najmniejsza liczba bitow w buforze strumienia po refill.
+    static constexpr unsigned REFILL_BITS = 56;
+
+    // Wyjscie dekodera: okno `window()` na `window_size()` bajtow, ktorego pierwsze
+    // `n` bajtow oddaje commit(n). Okno musi miec miejsce na co najmniej 3 bajty.
+    class StreamSink {
+    public:
+        StreamSink(std::ostream& output, std::uint32_t* output_checksum)
+            : out(output), checksum(output_checksum), chunk(OUT_CHUNK) {}
+        char* window() { return chunk.data(); }
+        std::size_t window_size() const { return chunk.size(); }
+        void commit(std::size_t n) {
+            if (checksum) *checksum = Crc32c::update(*checksum, reinterpret_cast<const std::uint8_t*>(chunk.data()), n);
+            out.write(chunk.data(), static_cast<std::streamsize>(n));
+        }
+
+    private:
+        std::ostream& out;
+        std::uint32_t* checksum;
+        std::vector<char> chunk;
+    };
+
+    // Dekodowanie wprost do pamieci; ostatnie bajty przed koncem pojemnosci
+    // przechodza przez maly bufor, bo wpis tablicy zapisuje zawsze 3 bajty.
+    class MemorySink {
+    public:
+        MemorySink(std::uint8_t* output, std::size_t output_capacity) : out(output), capacity(output_capacity) {}
+        char* window() { return direct() ? reinterpret_cast<char*>(out + used) : tail; }
+        std::size_t window_size() const { return direct() ? capacity - used : sizeof(tail); }
+        void commit(std::size_t n) {
+            if (!direct()) {
+                if (n > capacity - used) throw std::runtime_error("Za maly bufor wyjsciowy");
+                std::memcpy(out + used, tail, n);
+            }
+            used += n;
+        }
+
+    private:
+        std::uint8_t* out;
+        std::size_t capacity;
+        std::size_t used = 0;
+        char tail[8] = {};
+        bool direct() const { return capacity - used >= 3; }
+    };
+
+    template <typename Source, typename Sink>
+    std::uint64_t decode_to(Source& source, Sink& sink) const {
+        char* chunk = sink.window();
+        std::size_t chunk_size = sink.window_size();
+        std::size_t produced = 0;
+        std::uint64_t total = 0;
+
+        const std::uint8_t* data = nullptr;
+        std::size_t size = 0;
+        std::size_t pos = 0;
+        bool more = true;
+
+        std::uint64_t buffer = 0;
+        unsigned available = 0;
+        std::uint64_t consumed = 0;
+        // Liczba waznych bitow jest znana dopiero po pobraniu ostatniego fragmentu.
+        std::uint64_t limit = UINT64_MAX;
+
+        // Doladowuje bufor bitow do co najmniej 57 bitow (poza danymi - zera).
+        auto refill = [&]() {
+            if (pos + 8 <= size) {
+                buffer |= load_be64(data + pos) >> available;
+                pos += (63 - available) >> 3;
+                available |= 56;
+                return;
+            }
+            while (available <= 56) {
+                if (pos == size && more) {
+                    size = source.next(data);
+                    pos = 0;
+                    if (source.last()) {
+                        more = false;
+                        limit = source.total_bits();
+                    }
+                    continue;
+                }
+                std::uint64_t byte = pos < size ? data[pos++] : 0;
+                buffer |= byte << (56 - available);
+                available += 8;
+            }
+        };
+        auto consume = [&](unsigned n) {
+            buffer <<= n;
+            available -= n;
+            consumed += n;
+        };
+
+        while (true) {
+            if (produced + 3 > chunk_size) {
+                sink.commit(produced);
+                total += produced;
+                produced = 0;
+                chunk = sink.window();
+                chunk_size = sink.window_size();
+            }
+            refill();
+            if (consumed >= limit) break;
+
+            const Entry* entry = &entries[static_cast<std::size_t>(buffer >> (64 - root_bits))];
+            if (entry->count != 0) {
+                if (consumed + entry->bits <= limit) {
+                    chunk[produced] = static_cast<char>(entry->value);
+                    chunk[produced + 1] = static_cast<char>(entry->value >> 8);
+                    chunk[produced + 2] = static_cast<char>(entry->value >> 16);
+                    produced += entry->count;
+                    consume(entry->bits);
+                    continue;
+                }
+                if (consumed + entry->first_bits > limit) break;
+                chunk[produced++] = static_cast<char>(entry->value);
+                consume(entry->first_bits);
+                continue;
+            }
+
+            // Dlugi kod - przejscie przez podtablice.
+            while (entry->count == 0) {
+                if (entry->sub_bits == 0) {
+                    throw std::runtime_error("Niepoprawne dane skompresowane");
+                }
+                consume(entry->bits);
+                refill();
+                entry = &entries[entry->value + static_cast<std::size_t>(buffer >> (64 - entry->sub_bits))];
+            }
+            if (consumed + entry->bits > limit) break;
+            chunk[produced++] = static_cast<char>(entry->value);
+            consume(entry->bits);
+        }
+
+        sink.commit(produced);
+        return total + produced;
+    }
+
+    // Stan jednego strumienia przy dekodowaniu przeplatanym.
+    struct StreamState {
+        const std::uint8_t* data = nullptr;
+        std::size_t size = 0;
+        std::size_t pos = 0;
+        std::uint64_t buffer = 0;
+        unsigned available = 0;
+
+        // Liczba zuzytych bitow (pos liczy tez zera doladowane za koncem danych).
+        std::uint64_t consumed() const {
+            return static_cast<std::uint64_t>(pos) * 8 - available;
+        }
+    };
+
+    // Doladowuje bufor strumienia do co najmniej REFILL_BITS bitow (poza danymi - zera).
+    static void refill(StreamState& s) {
+        if (s.pos + 8 <= s.size) {
+            s.buffer |= load_be64(s.data + s.pos) >> s.available;
+            s.pos += (63 - s.available) >> 3;
+            s.available |= 56;
+            return;
+        }
+        while (s.available <= 56) {
+            std::uint64_t byte = s.pos < s.size ? s.data[s.pos] : 0;
+            s.pos++;
+            s.buffer |= byte << (56 - s.available);
+            s.available += 8;
+        }
+    }
+
+    static void consume(StreamState& s, unsigned n) {
+        s.buffer <<= n;
+        s.available -= n;
+    }
+
+    // Dekoduje jeden symbol strumienia (bez laczenia krotkich kodow w jednym wpisie).
+    // Bufor jest doladowywany dopiero, gdy moze zabraknac bitow na indeks korzenia.
+    std::uint8_t decode_symbol(StreamState& s) const {
+        if (s.available < root_bits) refill(s);
+        const Entry* entry = &entries[static_cast<std::size_t>(s.buffer >> (64 - root_bits))];
+        if (entry->count != 0) {
+            consume(s, entry->first_bits);
+            return static_cast<std::uint8_t>(entry->value);
+        }
+        while (entry->count == 0) {
+            if (entry->sub_bits == 0) invalid_data();
+            consume(s, entry->bits);
+            refill(s);
+            entry = &entries[entry->value + static_cast<std::size_t>(s.buffer >> (64 - entry->sub_bits))];
+        }
+        consume(s, entry->bits);
+        return static_cast<std::uint8_t>(entry->value);
+    }
+
+    // Jeden odczyt tablicy bez doladowania bufora: do trzech symboli wpisu korzenia
+    // (albo jeden dlugi kod z podtablic) trafia do `out`, `out + stride` i `out + 2 * stride`.
+    // Wywolujacy gwarantuje bity w buforze i miejsce na trzy symbole. Zwraca liczbe symboli.
+    unsigned decode_entry(StreamState& s, std::uint8_t* out, std::size_t stride) const {
+        const Entry* entry = &entries[static_cast<std::size_t>(s.buffer >> (64 - root_bits))];
+        while (entry->count == 0) {
+            if (entry->sub_bits == 0) invalid_data();
+            consume(s, entry->bits);
+            entry = &entries[entry->value + static_cast<std::size_t>(s.buffer >> (64 - entry->sub_bits))];
+        }
+        out[0] = static_cast<std::uint8_t>(entry->value);
+        out[stride] = static_cast<std::uint8_t>(entry->value >> 8);
+        out[2 * stride] = static_cast<std::uint8_t>(entry->value >> 16);
+        consume(s, entry->bits);
+        return entry->count;
+    }
+
+    // Dekoduje `symbol_count` symboli z N strumieni; symbol j strumienia k trafia do
+    // out[j * N + k]. Wiekszosc symboli dekoduja rundy (decode_rounds), a ostatnie
+    // symbole kazdego strumienia - pojedynczo, z doladowaniem bufora przed kazdym.
+    template <unsigned N>
+    void decode_streams(const std::uint8_t* const* streams, const std::size_t* sizes,
+                        std::uint64_t symbol_count, std::uint8_t* out) const {
+        StreamState state[N];
+        std::uint64_t next[N];
+        std::uint64_t end[N];
+        for (unsigned k = 0; k < N; ++k) {
+            state[k].data = streams[k];
+            state[k].size = sizes[k];
+            next[k] = 0;
+            end[k] = symbol_count / N + (k < symbol_count % N ? 1 : 0);
+        }
+
+        const unsigned lookups = REFILL_BITS / std::max(longest, root_bits);
+        if (lookups != 0) {
+            decode_rounds<N>(state, next, end, lookups, out, std::make_index_sequence<N>());
+            // Strumienie, ktore zostaly w tyle, dalej rundami, juz kazdy osobno.
+            for (unsigned k = 0; k < N; ++k) {
+                decode_rounds<N>(state + k, next + k, end + k, lookups, out + k, std::index_sequence<0>());
+            }
+        }
+        for (unsigned k = 0; k < N; ++k) {
+            for (; next[k] < end[k]; ++next[k]) out[next[k] * N + k] = decode_symbol(state[k]);
+        }
+
+        // Strumien nie moze konczyc sie przed ostatnim symbolem ani miec nadmiarowych bajtow.
+        for (unsigned k = 0; k < N; ++k) {
+            std::uint64_t consumed = state[k].consumed();
+            if (consumed > static_cast<std::uint64_t>(state[k].size) * 8 || (consumed + 7) / 8 != state[k].size) {
+                invalid_data();
+            }
+        }
+    }
+
+    // Rundy dekodowania strumieni `K...` (z N przeplatanych w `out`): kazdy strumien
+    // jest doladowywany raz na runde, a potem daje `lookups` odczytow tablicy (po 1-3
+    // symbole z polaczonych wpisow korzenia). Odczyt zuzywa najwyzej max(longest, root_bits)
+    // bitow, wiec po doladowaniu do REFILL_BITS bitow runda nie sprawdza stanu bufora.
+    // Rundy trwaja, dopoki kazdy strumien ma miejsce na 3 * lookups symboli. Strumienie
+    // sa rozwiniete w czasie kompilacji, wiec ich stan zostaje w rejestrach, a odczyty
+    // tablicy dla roznych strumieni nie czekaja na siebie.
+    template <unsigned N, std::size_t... K>
+    void decode_rounds(StreamState* state, std::uint64_t* next, const std::uint64_t* end, unsigned lookups,
+                       std::uint8_t* out, std::index_sequence<K...>) const {
+        const std::uint64_t margin = 3 * std::uint64_t{lookups};
+        while (((next[K] + margin <= end[K]) & ...)) {
+            (refill(state[K]), ...);
+            for (unsigned t = 0; t < lookups; ++t) {
+                ((next[K] += decode_entry(state[K], out + next[K] * N + K, N)), ...);
+            }
+        }
+    }
+
+    [[noreturn]] static void invalid_data() {
+        throw std::runtime_error("Niepoprawne dane skompresowane");
+    }
+
+    // Wpis tablicy. count > 0: do trzech symboli w `value`, razem `bits` bitow,
+    // pierwszy symbol ma `first_bits` bitow. count == 0: `bits` bitow prefiksu
+    // i podtablica pod indeksem `value` o szerokosci `sub_bits` (0 - brak kodu).
+    struct Entry {
+        std::uint32_t value = 0;
+        std::uint8_t count = 0;
+        std::uint8_t bits = 0;
+        std::uint8_t first_bits = 0;
+        std::uint8_t sub_bits = 0;
+    };
+
+    // Symbol z kodem wyrownanym do najstarszego bitu slowa.
+    struct Symbol {
+        std::uint64_t code;
+        unsigned length;
+        std::uint8_t byte;
+    };
+
+    unsigned root_bits = DEFAULT_BITS;
+    // Dlugosc najdluzszego kodu.
+    unsigned longest = 0;
+    std::vector<Entry> entries;
+    // Symbole posortowane po kodzie i kopia korzenia dla merge_short_symbols (pamiec do ponownego uzycia).
+    std::array<Symbol, 256> symbols{};
+    std::size_t symbol_count = 0;
+    std::vector<Entry> single;
+
+    // Wypelnia tablice o szerokosci `width` pod `offset` dla symboli [begin, end),
+    // ktore maja juz `consumed` bitow prefiksu zdekodowane na wyzszych poziomach.
+    // Symbole o tym samym indeksie w tablicy leza obok siebie i trafiaja do wspolnej podtablicy.
+    void fill_level(std::size_t offset, unsigned width, unsigned consumed, std::size_t begin, std::size_t end) {
+        auto index_of = [&](const Symbol& s) {
+            return static_cast<std::size_t>((s.code << consumed) >> (64 - width));
+        };
+
+        std::size_t i = begin;
+        while (i < end) {
+            const Symbol& s = symbols[i];
+            std::size_t index = index_of(s);
+            unsigned rest = s.length - consumed;
+            if (rest <= width) {
+                std::size_t last = index + (std::size_t{1} << (width - rest));
+                for (std::size_t k = index; k < last; ++k) {
+                    entries[offset + k] = Entry{s.byte, 1, static_cast<std::uint8_t>(rest),
+                                                static_cast<std::uint8_t>(rest), 0};
+                }
+                i++;
+                continue;
+            }
+
+            std::size_t group_end = i + 1;
+            unsigned max_rest = rest;
+            while (group_end < end && index_of(symbols[group_end]) == index) {
+                unsigned next_rest = symbols[group_end].length - consumed;
+                // Krotki kod z tym samym prefiksem - kody nie sa prefiksowe.
+                if (next_rest <= width) throw std::runtime_error("Niepoprawne kody Huffmana");
+                max_rest = std::max(max_rest, next_rest);
+                group_end++;
+            }
+            unsigned sub_width = std::min(max_rest - width, root_bits);
+            std::size_t sub_offset = entries.size();
+            entries.resize(sub_offset + (std::size_t{1} << sub_width));
+            entries[offset + index] = Entry{static_cast<std::uint32_t>(sub_offset), 0,
+                                            static_cast<std::uint8_t>(width), 0,
+                                            static_cast<std::uint8_t>(sub_width)};
+            fill_level(sub_offset, sub_width, consumed + width, i, group_end);
+            i = group_end;
+        }
+    }
+
+    // Dokleja do wpisow korzenia kolejne symbole, ktore mieszcza sie w tych samych bitach.
+    void merge_short_symbols() {
+        const std::size_t root_size = std::size_t{1} << root_bits;
+        single.assign(entries.begin(), entries.begin() + static_cast<std::ptrdiff_t>(root_size));
+
+        for (std::size_t i = 0; i < root_size; ++i) {
+            Entry& entry = entries[i];
+            if (entry.count == 0) continue;
+            while (entry.count < 3 && entry.bits < root_bits) {
+                const Entry& next = single[(i << entry.bits) & (root_size - 1)];
+                if (next.count == 0 || entry.bits + next.bits > root_bits) break;
+                entry.value |= next.value << (8 * entry.count);
+                entry.bits = static_cast<std::uint8_t>(entry.bits + next.bits);
+                entry.count++;
+            }
+        }
+    }
+
+    // Czyta 8 bajtow jako liczbe big-endian.
+    static std::uint64_t load_be64(const std::uint8_t* p) {
+        std::uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+#if defined(_MSC_VER)
+        return _byteswap_uint64(v);
+#elif defined(__GNUC__)
+        return __builtin_bswap64(v);
+#else
+        return (v >> 56) | ((v >> 40) & 0xFF00) | ((v >> 24) & 0xFF0000) | ((v >> 8) & 0xFF000000u)
+             | ((v & 0xFF000000u) << 8) | ((v & 0xFF0000) << 24) | ((v & 0xFF00) << 40) | (v << 56);
+#endif
+    }
+};
@@ -1,6 +1,11 @@
 #pragma once
 
-#include "huffman_tree.h"
+#include "adaptive_huffman.h"
+#include "huff_codec.h"
+#include "memory_stream.h"
+#include "ordered_pool.h"
+#include "pipeline.h"
+#include "file_io.h"
 
 #include <fstream>
 #include <string>
@@ -11,27 +16,42 @@
 #include <map>
 #include <sstream>
 #include <iterator>
+#include <algorithm>
+#include <optional>
+
+// Ustawienia kompresji pliku: kodowanie blokow (CodecOptions) oraz watki, indeks i sposob dostepu do plikow.
+struct CompressOptions : CodecOptions {
+    unsigned threads = 1;
+    bool with_index = false;
+    IoMode io_mode = IoMode::STREAM;
+    // Adaptacyjny kod Huffmana w jednym przebiegu (bez blokow; ustawienia blokow sa pomijane).
+    bool adaptive = false;
+    // Wspolna tablica kodow (--table): kodowanie bez zliczania bajtow i tablicy kodow
+    // w pliku (bez blokow; ustawienia blokow sa pomijane). nullptr - kody z danych.
+    const SharedTable* table = nullptr;
+    // Liczba buforow potoku odczyt-kodowanie-zapis (Pipeline; 0 - bez potoku).
+    unsigned pipeline = 0;
+};
 
 class FileHandler {
 public:
-    // Zliczanie wystąpień bajtów i zapis do mapy
-    static std::map<std::byte, uint32_t> count_bytes(const std::string& file_path) {
-        std::ifstream file_stream(file_path, std::ios::binary);
-        if (!file_stream.is_open()) {
-            throw std::runtime_error("Nie mo��na otworzy�A pliku.");
+    // Zliczanie wystąpień bajtów do histogramu. Plik odwzorowany w pamieci
+    // (IoMode::MMAP) moze byc liczony na `threads` watkach.
+    static ByteHistogram count_bytes(const std::string& file_path, IoMode io_mode = IoMode::STREAM,
+                                     unsigned threads = 1) {
+        InputFile input(file_path, io_mode);
+        if (input.data()) {
+            return ByteCounter::count_parallel(input.data(), static_cast<size_t>(input.size()), threads);
         }
 
-        std::map<std::byte, uint32_t> frequencies;
-        std::vector<unsigned char> buffer(16 * 1024);
+        ByteHistogram frequencies{};
+        std::istream& file_stream = input.stream();
+        std::vector<unsigned char> buffer(256 * 1024);
 
         while (file_stream) {
             file_stream.read(reinterpret_cast<char*>(buffer.data()),
                              static_cast<std::streamsize>(buffer.size()));
-            std::streamsize n = file_stream.gcount();
-            for (std::streamsize i = 0; i < n; ++i) {
-                std::byte b = static_cast<std::byte>(buffer[static_cast<size_t>(i)]);
-                frequencies[b]++;
-            }
+            ByteCounter::count(buffer.data(), static_cast<size_t>(file_stream.gcount()), frequencies);
         }
 
         if (file_stream.bad()) {
@@ -40,111 +60,598 @@ public:
         return frequencies;
     }
 
-    // Zapisuje do pliku nagłówek i skompresowane dane
-    static void write_bits(const std::string& input_path, 
-                           const std::string& output_path,
-                           const std::unordered_map<std::byte, std::string>& codes,
-                           const std::map<std::byte, uint32_t>& bytes_frequencies)
+    // Kompresuje plik do kontenera blokowego. Kazdy blok ma wlasna tablice kodow,
+    // bloki sa kodowane rownolegle na `threads` watkach i zapisywane po kolei;
+    // z `pipeline` odczyt i zapis maja wlasne watki polaczone pierscieniem buforow.
+    // Z `with_index` na koncu pliku zapisywany jest indeks blokow. Przy IoMode::MMAP
+    // bloki sa kodowane wprost z pliku odwzorowanego w pamieci.
+    static CompressionReport compress_file(const std::string& input_path,
+                                           const std::string& output_path,
+                                           const CompressOptions& options = CompressOptions{})
     {
-        std::ifstream in(input_path, std::ios::binary);
-        if (!in) { 
-            throw std::runtime_error("Nie mozna otworzyc pliku wejsciowego");
+        const unsigned threads = options.threads;
+        const bool with_index = options.with_index;
+        const IoMode io_mode = options.io_mode;
+        const size_t block_size = options.block_size;
+        HuffCodec::check_options(options);
+
+        InputFile input(input_path, io_mode, options.stats);
+        std::istream& in = input.stream();
+        if (in.peek() == std::char_traits<char>::eof()) {
+            throw std::runtime_error("Plik jest pusty.");
         }
-        std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
-        if (!out) { 
-            throw std::runtime_error("Nie mozna otworzyc pliku wwyjściowego");
+        if (options.adaptive) {
+            return compress_adaptive(input, output_path, options);
         }
-
-        write_header(out, bytes_frequencies);
-
-        uint8_t buffer = 0;
-        int bitCount = 0;
-
-        auto flush_byte = [&]() {
-            out.put(static_cast<char>(buffer));
-            buffer = 0;
-            bitCount = 0;
-        };
-        auto writeBit = [&](bool bit) {
-            buffer = static_cast<uint8_t>((buffer << 1) | (bit ? 1 : 0));
-            if (++bitCount == 8) flush_byte();
+        if (options.table) {
+            return compress_shared(input, output_path, options);
+        }
+        OutputFile output(output_path, io_mode, HuffCodec::compress_bound(static_cast<size_t>(input.size()), options),
+                          options.stats);
+        std::ostream& out = output.stream();
+
+        std::vector<uint8_t> header;
+        HuffFormat::write_signature(header, HuffFormat::VERSION_BLOCKS);
+        header.push_back(static_cast<uint8_t>((with_index ? HuffFormat::FLAG_INDEX : 0) | HuffCodec::container_flags(options)));
+        out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+        struct Job {
+            std::vector<uint8_t> raw;
+            const uint8_t* data = nullptr;
+            size_t size = 0;
+            HuffContext context;
+            std::vector<uint8_t> encoded;
+            size_t encoded_size = 0;
         };
-
-        char ch;
-        while (in.get(ch)) {
-            std::byte b = static_cast<std::byte>(static_cast<unsigned char>(ch));
-            auto itc = codes.find(b);
-            if (itc == codes.end()) {
-                throw std::runtime_error("Brak kodu Huffmana dla bajtu");
-            }
-            const std::string& codeBits = itc->second;
-            for (size_t i = 0; i < codeBits.size(); ++i) {
-                writeBit(codeBits[i] == '1');
+        CompressionReport report;
+        std::vector<BlockLocation> blocks;
+        BlockLocation next{HuffFormat::FIRST_BLOCK_OFFSET, 0, 0, 0};
+        uint64_t mapped_position = 0;
+
+        auto read = [&](Job& job) {
+            if (input.data()) {
+                job.data = input.data() + mapped_position;
+                job.size = static_cast<size_t>(std::min<uint64_t>(block_size, input.size() - mapped_position));
+                mapped_position += job.size;
+                return job.size != 0;
             }
+            job.raw.resize(block_size);
+            in.read(reinterpret_cast<char*>(job.raw.data()), static_cast<std::streamsize>(job.raw.size()));
+            job.data = job.raw.data();
+            job.size = static_cast<size_t>(in.gcount());
+            if (in.bad()) throw std::runtime_error("Wystąpił błąd odczytu pliku.");
+            return job.size != 0;
+        };
+        auto process = [&](Job& job) {
+            size_t bound = HuffCodec::block_bound(job.size, options.streams, options.order1);
+            if (job.encoded.size() < bound) job.encoded.resize(bound);
+            job.encoded_size = HuffCodec::compress_block(job.context, job.data, job.size, options,
+                                                         job.encoded.data(), job.encoded.size());
+        };
+        auto write = [&](Job& job) {
+            out.write(reinterpret_cast<const char*>(job.encoded.data()), static_cast<std::streamsize>(job.encoded_size));
+            if (!out) throw std::runtime_error("Blad zapisu pliku wyjsciowego");
+            next.size = job.encoded_size;
+            next.raw_size = job.size;
+            if (with_index) blocks.push_back(next);
+            next.offset += next.size;
+            next.raw_offset += next.raw_size;
+            report.add(job.context.report());
+        };
+        if (options.pipeline != 0) {
+            Pipeline::run<Job>(options.pipeline, threads, read, process, write, options.stats);
+        } else {
+            OrderedPool::run<Job>(threads, read, process, write);
         }
 
-        // padding
-        uint8_t padding = 0;
-        if (bitCount != 0) {
-            padding = static_cast<uint8_t>(8 - bitCount);
-            buffer <<= padding;
-            out.put(static_cast<char>(buffer));
-        }
-        out.put(static_cast<char>(padding));
+        std::vector<uint8_t> end;
+        HuffFormat::write_varint(end, 0);
+        if (with_index) HuffFormat::write_index(end, blocks, next.offset + 1);
+        out.write(reinterpret_cast<const char*>(end.data()), static_cast<std::streamsize>(end.size()));
+        output.close();
+        if (options.stats) options.stats->add_sizes(report.input_size, output.bytes_written());
+        return report;
     }
 
-    
-    // Odczytuje czestotliwosci z naglowka pliku.
-    static std::map<std::byte, uint32_t> get_frequencies(const std::string& file_path) {
+    // Odczytuje czestotliwosci z naglowka pliku w starym formacie tekstowym.
+    static std::map<std::byte, uint64_t> get_frequencies(const std::string& file_path) {
         std::ifstream in(file_path, std::ios::binary);
         if (!in) throw std::runtime_error("Nie mo��na otworzy�A pliku");
 
         return read_header(in);
     }
 
-    // Dekompresuje plik Huffmana do postaci binarnej.
+    // Dekompresuje plik Huffmana do postaci binarnej. Dla kontenera blokowego
+    // bloki moga byc dekodowane na `threads` watkach, a [range_begin, range_end)
+    // ogranicza wynik do fragmentu danych - dekodowane sa tylko bloki, ktore go pokrywaja.
+    // Z `stats` mierzone sa etapy dekompresji i rozmiary. Pliki skompresowane
+    // wspolna tablica kodow wymagaja tej samej tablicy (`table`). Z `pipeline` buforami
+    // bloki kontenera sa czytane, dekodowane i zapisywane w osobnych watkach (Pipeline).
     static void decompress_file(const std::string& input_path,
-                                const std::string& output_path)
+                                const std::string& output_path,
+                                unsigned threads = 1,
+                                uint64_t range_begin = 0,
+                                uint64_t range_end = UINT64_MAX,
+                                IoMode io_mode = IoMode::STREAM,
+                                RunStats* stats = nullptr,
+                                const SharedTable* table = nullptr,
+                                unsigned pipeline = 0)
     {
-        std::ifstream in(input_path, std::ios::binary);
-        if (!in) throw std::runtime_error("Nie mozna otworzyc pliku wejsciowego");
+        InputFile input(input_path, io_mode, stats);
+        std::istream& in = input.stream();
+        OutputFile output(output_path, io_mode, output_size_hint(input, range_begin, range_end), stats);
+        std::ostream& out = output.stream();
+        decompress_stream(in, input.data(), input.size(), out, threads, range_begin, range_end, stats, table, pipeline);
+        output.close();
+        if (stats) stats->add_sizes(input.bytes_read(), output.bytes_written());
+    }
 
-        std::ofstream out(output_path, std::ios::binary | std::ios::trunc);
-        if (!out) throw std::runtime_error("Nie mozna otworzyc pliku wyjsciowego");
+private:
+    // Rozmiar wyniku dekompresji do rezerwacji pliku wyjsciowego. Dla pliku odwzorowanego
+    // w pamieci jest dokladny (suma rozmiarow blokow z naglowkow, bez dekodowania),
+    // dla pozostalych formatow i wejscia strumieniowego - szacowany.
+    static uint64_t output_size_hint(const InputFile& input, uint64_t range_begin, uint64_t range_end) {
+        if (input.data()) {
+            try {
+                uint64_t total = HuffCodec::decompressed_size(input.data(), static_cast<size_t>(input.size()));
+                return std::min(total, range_end) - std::min(total, range_begin);
+            } catch (const std::runtime_error&) {
+                // Inny format albo uszkodzony plik - blad zglosi dekompresja.
+            }
+        }
+        return input.size() * 2;
+    }
 
-        std::map<std::byte, uint32_t> freq = read_header(in);
+    // Kompresja adaptacyjna: sygnatura z wersja VERSION_ADAPTIVE i strumien bitow
+    // kodowany w jednym przebiegu, bez histogramu i tablicy kodow.
+    static CompressionReport compress_adaptive(InputFile& input, const std::string& output_path,
+                                               const CompressOptions& options) {
+        OutputFile output(output_path, options.io_mode, static_cast<size_t>(input.size()) + 64, options.stats);
+        std::ostream& out = output.stream();
+        std::vector<uint8_t> header;
+        HuffFormat::write_signature(header, HuffFormat::VERSION_ADAPTIVE);
+        out.write(reinterpret_cast<const char*>(header.data()), static_cast<std::streamsize>(header.size()));
+
+        CompressionReport report;
+        // Rozmiar danych liczy koder - OutputFile zlicza bajty tylko przy pomiarach.
+        uint64_t payload_size = 0;
+        {
+            PhaseTimer timer(options.stats, RunStats::CODING);
+            report.input_size = AdaptiveHuffman::compress(input.stream(), out, &payload_size);
+        }
+        output.close();
+        report.payload_bits = payload_size * 8;
+        report.unlimited_payload_bits = report.payload_bits;
+        if (options.stats) {
+            options.stats->add_block(report.input_size, payload_size, payload_size * 8, 0);
+            options.stats->add_sizes(report.input_size, output.bytes_written());
+        }
+        return report;
+    }
 
-        std::unique_ptr<HuffmanTree> tree = HuffmanTree::from_frequencies(freq);
-        std::vector<unsigned char> tail((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+    // Kompresja wspolna tablica kodow: cale wejscie (plik odwzorowany w pamieci albo
+    // wczytany strumien) jest kodowane jednym przebiegiem do formatu VERSION_SHARED.
+    // Tablica jest przeznaczona dla malych plikow, wiec wynik powstaje w pamieci.
+    static CompressionReport compress_shared(InputFile& input, const std::string& output_path,
+                                             const CompressOptions& options) {
+        const SharedTable& table = *options.table;
+        std::vector<uint8_t> raw;
+        const uint8_t* data = input.data();
+        size_t size = static_cast<size_t>(input.size());
+        if (!data) {
+            read_all(input.stream(), raw);
+            data = raw.data();
+            size = raw.size();
+        }
 
-        if (tail.empty()) return;
+        std::vector<uint8_t> packed;
+        {
+            PhaseTimer timer(options.stats, RunStats::CODING);
+            HuffCodec::compress(table, data, size, packed);
+        }
+        OutputFile output(output_path, options.io_mode, packed.size(), options.stats);
+        output.stream().write(reinterpret_cast<const char*>(packed.data()), static_cast<std::streamsize>(packed.size()));
+        output.close();
+
+        // Za naglowkiem (sygnatura, identyfikator tablicy, rozmiar i padding) jest strumien bitow.
+        const size_t header = sizeof(HuffFormat::MAGIC) + 1 + 4 + HuffFormat::varint_size(size) + 1;
+        const uint64_t payload_size = packed.size() - header;
+        CompressionReport report;
+        report.input_size = size;
+        report.payload_bits = payload_size * 8 - packed[header - 1];
+        report.unlimited_payload_bits = report.payload_bits;
+        report.longest_code = table.longest();
+        if (options.stats) {
+            options.stats->add_block(size, payload_size, report.payload_bits, table.longest());
+            options.stats->add_sizes(size, output.bytes_written());
+        }
+        return report;
+    }
 
-        uint8_t padding = static_cast<uint8_t>(tail.back());
-        tail.pop_back();
+    // Czyta strumien do konca i dopisuje dane do `buffer`.
+    static void read_all(std::istream& in, std::vector<uint8_t>& buffer) {
+        const size_t chunk = 64 * 1024;
+        while (in) {
+            size_t used = buffer.size();
+            buffer.resize(used + chunk);
+            in.read(reinterpret_cast<char*>(buffer.data() + used), static_cast<std::streamsize>(chunk));
+            buffer.resize(used + static_cast<size_t>(in.gcount()));
+        }
+        if (in.bad()) throw std::runtime_error("Wystąpił błąd odczytu pliku.");
+    }
 
-        std::vector<uint8_t> payload;
-        payload.assign(tail.begin(), tail.end());
+    // Dekoduje plik .huff ze strumienia. Gdy `mapped` wskazuje caly plik w pamieci,
+    // dane blokow sa dekodowane wprost z niego, bez kopiowania do buforow.
+    static void decompress_stream(std::istream& in, const uint8_t* mapped, uint64_t mapped_size,
+                                  std::ostream& out, unsigned threads,
+                                  uint64_t range_begin, uint64_t range_end, RunStats* stats,
+                                  const SharedTable* shared_table, unsigned pipeline)
+    {
+        bool whole_file = range_begin == 0 && range_end == UINT64_MAX;
+        int version = HuffFormat::read_version(in);
+        if (version == HuffFormat::VERSION_BLOCKS) {
+            int flags = in.get();
+            if (flags == std::char_traits<char>::eof() || (flags & ~HuffFormat::KNOWN_FLAGS) != 0) {
+                throw std::runtime_error("Nieobslugiwane flagi formatu pliku");
+            }
+            if (threads <= 1 && whole_file && pipeline == 0) {
+                decompress_blocks(in, mapped, mapped_size, out, static_cast<uint8_t>(flags), stats);
+                return;
+            }
+            // Potoku nie da sie przewijac - bloki sa wtedy czytane po kolei. Tak samo
+            // czyta je watek odczytu Pipeline, gdy potrzebny jest caly plik.
+            if ((pipeline != 0 && whole_file) || in.tellg() == std::streampos(-1)) {
+                in.clear();
+                decompress_block_range(in, mapped, mapped_size, out, nullptr, threads, range_begin, range_end,
+                                       static_cast<uint8_t>(flags), stats, pipeline);
+                return;
+            }
+            std::vector<BlockLocation> blocks = (flags & HuffFormat::FLAG_INDEX)
+                ? HuffFormat::read_index(in)
+                : scan_blocks(in, static_cast<uint8_t>(flags));
+            decompress_block_range(in, mapped, mapped_size, out, &blocks, threads, range_begin, range_end,
+                                   static_cast<uint8_t>(flags), stats, pipeline);
+            return;
+        }
+        if (!whole_file) {
+            throw std::runtime_error("Zakres (-r) jest dostepny tylko dla plikow w formacie blokowym.");
+        }
+        if (version == HuffFormat::VERSION_ADAPTIVE) {
+            PhaseTimer timer(stats, RunStats::CODING);
+            std::optional<BitReader> reader;
+            if (mapped) {
+                uint64_t start = std::min(static_cast<uint64_t>(in.tellg()), mapped_size);
+                reader.emplace(mapped + start, static_cast<size_t>(mapped_size - start));
+            } else {
+                reader.emplace(in);
+            }
+            uint64_t produced = AdaptiveHuffman::decompress(*reader, out);
+            if (stats) stats->add_block(produced, (reader->bits_read() + 7) / 8, reader->bits_read(), 0);
+            return;
+        }
+        if (version == HuffFormat::VERSION_SHARED) {
+            if (!shared_table) {
+                throw std::runtime_error("Plik zostal skompresowany wspolna tablica kodow - podaj ja opcja --table.");
+            }
+            decompress_shared(in, mapped, mapped_size, out, *shared_table, stats);
+            return;
+        }
 
-        tree->decode_payload_to_stream(payload, padding, out);
+        std::optional<DecodeTable> table;
+        unsigned longest = 0;
+        {
+            PhaseTimer timer(stats, RunStats::TREE);
+            CodeTable codes = version == HuffFormat::VERSION_CANONICAL
+                ? CanonicalCodes::from_lengths(HuffFormat::read_code_lengths(in))
+                : legacy_code_table(in);
+            table.emplace(codes);
+            for (const HuffmanCode& code : codes) longest = std::max<unsigned>(longest, code.length);
+        }
+        PhaseTimer timer(stats, RunStats::CODING);
+        if (mapped) {
+            uint64_t start = static_cast<uint64_t>(in.tellg());
+            if (start >= mapped_size) return;
+            uint8_t padding = mapped[mapped_size - 1];
+            uint64_t payload_size = mapped_size - 1 - start;
+            if (padding > 7 || (payload_size == 0 && padding != 0)) throw std::runtime_error("Niepoprawny padding");
+            MemoryPayloadSource source(mapped + start, static_cast<size_t>(payload_size), payload_size * 8 - padding);
+            uint64_t produced = table->decode(source, out);
+            if (stats) stats->add_block(produced, payload_size, payload_size * 8 - padding, longest);
+            return;
+        }
+        // Dane sa czytane i dekodowane fragmentami, wiec zuzycie pamieci nie zalezy od rozmiaru pliku.
+        StreamPayloadSource source(in);
+        uint64_t produced = table->decode(source, out);
+        if (stats) stats->add_block(produced, (source.total_bits() + 7) / 8, source.total_bits(), longest);
     }
 
-private:
-    // Koduje bajt do postaci tokenu naglowka.
-    static std::string encode_symbol(std::byte symbol) {
-        unsigned char c = std::to_integer<unsigned char>(symbol);
-        if (c == '\\') return "\\\\";
-        if (c == '\n') return "\\n";
-        if (c == '\r') return "\\r";
-        if (c == '\t') return "\\t";
-        if (c == ':') return "\\:";
-        if (c == ' ') return "\\s";
-        if (c >= 32 && c <= 126) return std::string(1, static_cast<char>(c)); // możliwe do druku ASCII
-
-        const char* hex = "0123456789ABCDEF";
-        std::string out = "\\x";
-        out.push_back(hex[(c >> 4) & 0xF]);
-        out.push_back(hex[c & 0xF]);
-        return out;
+    // Dekoduje dane VERSION_SHARED (za bajtem wersji) wspolna tablica kodow.
+    static void decompress_shared(std::istream& in, const uint8_t* mapped, uint64_t mapped_size, std::ostream& out,
+                                  const SharedTable& table, RunStats* stats) {
+        std::vector<uint8_t> buffer;
+        const uint8_t* data = nullptr;
+        const uint8_t* end = nullptr;
+        if (mapped) {
+            uint64_t start = std::min(static_cast<uint64_t>(in.tellg()), mapped_size);
+            data = mapped + start;
+            end = mapped + mapped_size;
+        } else {
+            read_all(in, buffer);
+            data = buffer.data();
+            end = data + buffer.size();
+        }
+
+        PhaseTimer timer(stats, RunStats::CODING);
+        const uint8_t* payload = data;
+        uint8_t padding = 0;
+        uint64_t raw_size = HuffCodec::read_shared_header(table, payload, end, padding);
+        std::vector<uint8_t> raw(static_cast<size_t>(raw_size));
+        HuffCodec::decode_shared(table, data, end, raw.data(), raw.size());
+        out.write(reinterpret_cast<const char*>(raw.data()), static_cast<std::streamsize>(raw.size()));
+        if (stats) {
+            uint64_t payload_size = static_cast<uint64_t>(end - payload);
+            stats->add_block(raw_size, payload_size, payload_size * 8 - padding, table.longest());
+        }
+    }
+
+    // Dekoduje kolejne bloki kontenera az do bloku o rozmiarze 0. Bloki z kilkoma
+    // strumieniami, bloki modelu rzedu 1 (`flags`) i bloki bez kodowania sa czytane
+    // w calosci i dekodowane w pamieci.
+    static void decompress_blocks(std::istream& in, const uint8_t* mapped, uint64_t mapped_size, std::ostream& out,
+                                  uint8_t flags, RunStats* stats) {
+        const bool order1 = (flags & HuffFormat::FLAG_ORDER1) != 0;
+        const bool in_memory = order1 || (flags & HuffFormat::FLAG_STREAMS) != 0;
+        BlockPayloadSource source(in);
+        std::vector<uint8_t> payload_buffer;
+        std::vector<uint8_t> raw;
+        while (true) {
+            uint64_t raw_size = HuffFormat::read_varint(in);
+            if (raw_size == 0) break;
+
+            ContextTables tables = HuffFormat::read_block_tables(in, flags);
+            uint64_t payload_size = HuffFormat::read_varint(in);
+            uint8_t padding = read_padding(in);
+            if (stats) stats->add_block(raw_size, payload_size, payload_size * 8 - padding, ContextModel::longest(tables));
+
+            if (in_memory || tables.stored) {
+                const uint8_t* payload = mapped
+                    ? mapped_payload(in, mapped, mapped_size, payload_size, padding)
+                    : read_payload(in, payload_size, payload_buffer);
+                decode_memory_block(tables, order1, payload, static_cast<size_t>(payload_size), padding, raw_size, raw,
+                                    stats);
+                HuffCodec::verify_checksum(tables, flags, raw.data(), raw.size());
+                out.write(reinterpret_cast<const char*>(raw.data()), static_cast<std::streamsize>(raw.size()));
+                continue;
+            }
+
+            std::optional<DecodeTable> table;
+            {
+                PhaseTimer timer(stats, RunStats::TREE);
+                table.emplace(CanonicalCodes::from_lengths(tables.lengths[0]));
+            }
+            PhaseTimer timer(stats, RunStats::CODING);
+            // Suma kontrolna jest liczona z paczek wyniku przed ich zapisem.
+            uint32_t checksum = 0;
+            uint32_t* block_checksum = (flags & HuffFormat::FLAG_CHECKSUM) ? &checksum : nullptr;
+            uint64_t produced = 0;
+            if (mapped) {
+                const uint8_t* payload = mapped_payload(in, mapped, mapped_size, payload_size, padding);
+                MemoryPayloadSource memory(payload, static_cast<size_t>(payload_size), payload_size * 8 - padding);
+                produced = table->decode(memory, out, block_checksum);
+            } else {
+                source.reset(payload_size, padding);
+                produced = table->decode(source, out, block_checksum);
+            }
+            if (produced != raw_size) {
+                throw std::runtime_error("Niepoprawny rozmiar bloku");
+            }
+            if (block_checksum && checksum != tables.checksum) {
+                throw std::runtime_error("Niezgodna suma kontrolna bloku");
+            }
+        }
+    }
+
+    // Czyta dane bloku do `buffer` i zwraca wskaznik na nie.
+    static const uint8_t* read_payload(std::istream& in, uint64_t payload_size, std::vector<uint8_t>& buffer) {
+        buffer.resize(static_cast<size_t>(payload_size));
+        in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(payload_size));
+        if (static_cast<uint64_t>(in.gcount()) != payload_size) {
+            throw std::runtime_error("Niepoprawny koniec pliku");
+        }
+        return buffer.data();
+    }
+
+    // Dekoduje do `raw` blok modelu rzedu 1 (`order1`), blok zapisany w kilku
+    // przeplatanych strumieniach albo blok bez kodowania.
+    static void decode_memory_block(const ContextTables& tables, bool order1, const uint8_t* payload, size_t payload_size,
+                                    uint8_t padding, uint64_t raw_size, std::vector<uint8_t>& raw, RunStats* stats) {
+        if (raw_size > static_cast<uint64_t>(payload_size) * 8) throw std::runtime_error("Niepoprawny naglowek bloku");
+        if (tables.stored) {
+            PhaseTimer timer(stats, RunStats::CODING);
+            raw.resize(static_cast<size_t>(raw_size));
+            HuffCodec::copy_stored_block(payload, payload_size, padding, raw_size, raw.data());
+            return;
+        }
+        if (order1) {
+            std::vector<DecodeTable> decoders;
+            {
+                PhaseTimer timer(stats, RunStats::TREE);
+                HuffCodec::build_context_decoders(tables, decoders);
+            }
+            PhaseTimer timer(stats, RunStats::CODING);
+            raw.resize(static_cast<size_t>(raw_size));
+            HuffCodec::decode_context_block(tables, decoders, payload, payload_size, padding, raw_size, raw.data());
+            return;
+        }
+        std::optional<DecodeTable> table;
+        {
+            PhaseTimer timer(stats, RunStats::TREE);
+            table.emplace(CanonicalCodes::from_lengths(tables.lengths[0]));
+        }
+        PhaseTimer timer(stats, RunStats::CODING);
+        raw.resize(static_cast<size_t>(raw_size));
+        HuffCodec::decode_streams_block(*table, payload, payload_size, padding, raw_size, raw.data());
+    }
+
+    // Zwraca wskaznik na dane bloku w odwzorowanym pliku i przesuwa strumien za nie.
+    static const uint8_t* mapped_payload(std::istream& in, const uint8_t* mapped, uint64_t mapped_size,
+                                         uint64_t payload_size, uint8_t padding) {
+        uint64_t start = static_cast<uint64_t>(in.tellg());
+        if (start > mapped_size || payload_size > mapped_size - start) {
+            throw std::runtime_error("Niepoprawny koniec pliku");
+        }
+        if (payload_size == 0 && padding != 0) throw std::runtime_error("Niepoprawny padding");
+        in.seekg(static_cast<std::streamoff>(payload_size), std::ios::cur);
+        return mapped + start;
+    }
+
+    // Wyznacza polozenie blokow bez indeksu, przeskakujac dane kolejnych blokow.
+    static std::vector<BlockLocation> scan_blocks(std::istream& in, uint8_t flags) {
+        std::vector<BlockLocation> blocks;
+        BlockLocation block{HuffFormat::FIRST_BLOCK_OFFSET, 0, 0, 0};
+        while (true) {
+            block.raw_size = HuffFormat::read_varint(in);
+            if (block.raw_size == 0) break;
+            HuffFormat::read_block_tables(in, flags);
+            uint64_t payload_size = HuffFormat::read_varint(in);
+            read_padding(in);
+            in.seekg(static_cast<std::streamoff>(payload_size), std::ios::cur);
+            uint64_t end = static_cast<uint64_t>(in.tellg());
+            if (!in) throw std::runtime_error("Niepoprawny koniec pliku");
+            block.size = end - block.offset;
+            blocks.push_back(block);
+            block.offset = end;
+            block.raw_offset += block.raw_size;
+        }
+        return blocks;
+    }
+
+    // Dekoduje bloki pokrywajace [range_begin, range_end) na `threads` watkach
+    // i zapisuje po kolei wlasciwe fragmenty ich danych. Bez listy `blocks`
+    // (wejscie bez przewijania) bloki sa czytane kolejno od biezacej pozycji.
+    // Z `pipeline` buforami odczyt i zapis maja wlasne watki (Pipeline).
+    static void decompress_block_range(std::istream& in, const uint8_t* mapped, uint64_t mapped_size, std::ostream& out,
+                                       const std::vector<BlockLocation>* blocks, unsigned threads,
+                                       uint64_t range_begin, uint64_t range_end, uint8_t flags, RunStats* stats,
+                                       unsigned pipeline) {
+        const bool order1 = (flags & HuffFormat::FLAG_ORDER1) != 0;
+        const bool in_memory = order1 || (flags & HuffFormat::FLAG_STREAMS) != 0;
+        std::vector<BlockLocation>::const_iterator next;
+        if (blocks) {
+            next = std::upper_bound(blocks->begin(), blocks->end(), range_begin,
+                [](uint64_t position, const BlockLocation& block) { return position < block.raw_offset + block.raw_size; });
+        }
+        uint64_t raw_offset = 0;
+        bool finished = false;
+
+        struct Job {
+            BlockLocation block{};
+            ContextTables tables;
+            uint64_t raw_size = 0;
+            uint8_t padding = 0;
+            const uint8_t* payload = nullptr;
+            size_t payload_size = 0;
+            std::vector<uint8_t> payload_buffer;
+            std::vector<uint8_t> raw;
+        };
+
+        auto read = [&](Job& job) {
+            if (blocks) {
+                if (next == blocks->end() || next->raw_offset >= range_end) return false;
+                job.block = *next++;
+                in.clear();
+                in.seekg(static_cast<std::streamoff>(job.block.offset));
+            }
+            uint64_t payload_size = 0;
+            while (true) {
+                if (finished || (!blocks && raw_offset >= range_end)) return false;
+                job.raw_size = HuffFormat::read_varint(in);
+                if (blocks && job.raw_size != job.block.raw_size) {
+                    throw std::runtime_error("Niepoprawny indeks blokow");
+                }
+                if (job.raw_size == 0) {
+                    // Znacznik konca - kolejne wywolania nie moga czytac dalej.
+                    finished = true;
+                    return false;
+                }
+                job.tables = HuffFormat::read_block_tables(in, flags);
+                payload_size = HuffFormat::read_varint(in);
+                job.padding = read_padding(in);
+                if (blocks) {
+                    if (payload_size > job.block.size) throw std::runtime_error("Niepoprawny indeks blokow");
+                    break;
+                }
+                job.block = BlockLocation{0, 0, raw_offset, job.raw_size};
+                raw_offset += job.raw_size;
+                if (raw_offset > range_begin) break;
+                // Blok przed zakresem - pomijamy jego dane.
+                in.ignore(static_cast<std::streamsize>(payload_size));
+                if (static_cast<uint64_t>(in.gcount()) != payload_size) {
+                    throw std::runtime_error("Niepoprawny koniec pliku");
+                }
+            }
+            job.payload_size = static_cast<size_t>(payload_size);
+            if (stats) {
+                stats->add_block(job.raw_size, payload_size, payload_size * 8 - job.padding,
+                                 ContextModel::longest(job.tables));
+            }
+            if (mapped) {
+                job.payload = mapped_payload(in, mapped, mapped_size, payload_size, job.padding);
+                return true;
+            }
+            job.payload = read_payload(in, payload_size, job.payload_buffer);
+            return true;
+        };
+        auto process = [&](Job& job) {
+            if (in_memory || job.tables.stored) {
+                decode_memory_block(job.tables, order1, job.payload, job.payload_size, job.padding, job.raw_size,
+                                    job.raw, stats);
+                HuffCodec::verify_checksum(job.tables, flags, job.raw.data(), job.raw.size());
+                return;
+            }
+            if (job.payload_size == 0 && job.padding != 0) throw std::runtime_error("Niepoprawny padding");
+            std::optional<DecodeTable> table;
+            {
+                PhaseTimer timer(stats, RunStats::TREE);
+                table.emplace(CanonicalCodes::from_lengths(job.tables.lengths[0]));
+            }
+            PhaseTimer timer(stats, RunStats::CODING);
+            MemoryPayloadSource source(job.payload, job.payload_size,
+                                       static_cast<uint64_t>(job.payload_size) * 8 - job.padding);
+            job.raw.clear();
+            job.raw.reserve(static_cast<size_t>(job.raw_size));
+            VectorOutputBuffer buffer(job.raw);
+            std::ostream raw_out(&buffer);
+            uint32_t checksum = 0;
+            uint32_t* block_checksum = (flags & HuffFormat::FLAG_CHECKSUM) ? &checksum : nullptr;
+            table->decode(source, raw_out, block_checksum);
+            if (job.raw.size() != job.raw_size) {
+                throw std::runtime_error("Niepoprawny rozmiar bloku");
+            }
+            if (block_checksum && checksum != job.tables.checksum) {
+                throw std::runtime_error("Niezgodna suma kontrolna bloku");
+            }
+        };
+        auto write = [&](Job& job) {
+            uint64_t begin = std::max(range_begin, job.block.raw_offset) - job.block.raw_offset;
+            uint64_t end = std::min(range_end, job.block.raw_offset + job.raw_size) - job.block.raw_offset;
+            out.write(reinterpret_cast<const char*>(job.raw.data() + begin), static_cast<std::streamsize>(end - begin));
+            if (!out) throw std::runtime_error("Blad zapisu pliku wyjsciowego");
+        };
+        if (pipeline != 0) {
+            Pipeline::run<Job>(pipeline, threads, read, process, write, stats);
+        } else {
+            OrderedPool::run<Job>(threads, read, process, write);
+        }
+    }
+
+    // Czyta bajt paddingu naglowka bloku.
+    static uint8_t read_padding(std::istream& in) {
+        int padding = in.get();
+        if (padding == std::char_traits<char>::eof() || padding > 7) {
+            throw std::runtime_error("Niepoprawny naglowek bloku");
+        }
+        return static_cast<uint8_t>(padding);
     }
 
     // Dekoduje token naglowka do bajtu.
@@ -179,26 +686,18 @@ private:
         throw std::runtime_error("Niepoprawny znak w naglowku");
     }
 
-    // Zapisuje naglowek jako czyste ASCII, a dane pozostawia binarne.
-    static void write_header(std::ostream& out, const std::map<std::byte, uint32_t>& bytes_frequencies) {
-        std::string header;
-        header.reserve(bytes_frequencies.size() * 16);
-        bool first = true;
-        for (auto it = bytes_frequencies.begin(); it != bytes_frequencies.end(); ++it) {
-            if (!first) header += " ";
-            first = false;
-            header += encode_symbol(it->first);
-            header += ":";
-            header += std::to_string(it->second);
-        }
-        header += "\n";
-        header += "\n";
-        out.write(header.data(), static_cast<std::streamsize>(header.size()));
+    // Odtwarza kody starego formatu tekstowego z drzewa zbudowanego z czestotliwosci.
+    static CodeTable legacy_code_table(std::istream& in) {
+        std::map<std::byte, uint64_t> freq = read_header(in);
+        if (freq.empty()) return CodeTable{};
+        ByteHistogram histogram{};
+        for (const auto& entry : freq) histogram[std::to_integer<unsigned>(entry.first)] = entry.second;
+        return HuffmanTree::from_frequencies(histogram, true).build_huffman_codes();
     }
 
-    // Czyta naglowek i zwraca mape czestotliwosci.
-    static std::map<std::byte, uint32_t> read_header(std::istream& in) {
-        std::map<std::byte, uint32_t> freq;
+    // Czyta naglowek starego formatu tekstowego i zwraca mape czestotliwosci.
+    static std::map<std::byte, uint64_t> read_header(std::istream& in) {
+        std::map<std::byte, uint64_t> freq;
         std::string line;
         bool saw_blank = false;
 
@@ -210,8 +709,9 @@ private:
             std::istringstream iss(line);
             std::string pair_token;
             while (iss >> pair_token) {
-                size_t colon = pair_token.find(':');
-                if (colon == std::string::npos || colon == 0) {
+                // Dwukropek wewnatrz tokenu symbolu jest poprzedzony '\\'.
+                size_t colon = pair_token.find(':', pair_token[0] == '\\' ? 2 : 1);
+                if (colon == std::string::npos) {
                     throw std::runtime_error("Niepoprawny naglowek pliku");
                 }
 
@@ -221,7 +721,7 @@ private:
                     throw std::runtime_error("Niepoprawny naglowek pliku");
                 }
 
-                uint32_t frequency = static_cast<uint32_t>(std::stoul(number));
+                uint64_t frequency = static_cast<uint64_t>(std::stoull(number));
                 std::byte symbol = decode_symbol_token(token);
                 freq[symbol] = frequency;
             }
@@ -0,0 +1,601 @@
+#pragma once
+
+#include "run_stats.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Sposob dostepu do plikow: buforowane strumienie albo odwzorowanie w pamieci.
+enum class IoMode {
+    STREAM,
+    MMAP
+};
+
+// Sciezka "-" oznacza standardowe wejscie albo wyjscie.
+inline bool is_standard_stream(const std::string& path) {
+    return path == "-";
+}
+
+// Bufor strumienia czytajacy stdin w trybie binarnym. Nie obsluguje seekg,
+// wiec tellg() zwraca -1 - tak jak dla potoku.
+class StdinBuffer : public std::streambuf {
+public:
+    StdinBuffer() : buffer(CHUNK) {
+#if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        std::size_t n = std::fread(buffer.data(), 1, buffer.size(), stdin);
+        if (n == 0) return traits_type::eof();
+        setg(buffer.data(), buffer.data(), buffer.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+private:
+    static constexpr std::size_t CHUNK = 256 * 1024;
+    std::vector<char> buffer;
+};
+
+// Bufor strumienia zapisujacy na stdout w trybie binarnym.
+class StdoutBuffer : public std::streambuf {
+public:
+    StdoutBuffer() : buffer(CHUNK) {
+#if defined(_WIN32)
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!flush_buffer()) return traits_type::eof();
+        if (ch != traits_type::eof()) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    int sync() override {
+        return flush_buffer() && std::fflush(stdout) == 0 ? 0 : -1;
+    }
+
+private:
+    static constexpr std::size_t CHUNK = 256 * 1024;
+    std::vector<char> buffer;
+
+    bool flush_buffer() {
+        std::size_t n = static_cast<std::size_t>(pptr() - pbase());
+        if (n != 0 && std::fwrite(pbase(), 1, n, stdout) != n) return false;
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return true;
+    }
+};
+
+// Bufor strumienia czytajacy z ciaglego obszaru pamieci (z obsluga seekg/tellg).
+class MemoryInputBuffer : public std::streambuf {
+public:
+    MemoryInputBuffer(const std::uint8_t* data, std::size_t size) {
+        char* begin = const_cast<char*>(reinterpret_cast<const char*>(data));
+        setg(begin, begin, begin + size);
+    }
+
+protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        if (!(which & std::ios_base::in)) return pos_type(off_type(-1));
+        off_type base = dir == std::ios_base::beg ? 0
+                      : dir == std::ios_base::cur ? gptr() - eback()
+                      : egptr() - eback();
+        off_type target = base + off;
+        if (target < 0 || target > egptr() - eback()) return pos_type(off_type(-1));
+        setg(eback(), eback() + target, egptr());
+        return pos_type(target);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        return seekoff(off_type(pos), std::ios_base::beg, which);
+    }
+
+    std::streamsize xsgetn(char* s, std::streamsize n) override {
+        std::streamsize available = egptr() - gptr();
+        if (n > available) n = available;
+        std::memcpy(s, gptr(), static_cast<std::size_t>(n));
+        setg(eback(), gptr() + n, egptr());
+        return n;
+    }
+};
+
+// Bufor posredniczacy, ktory mierzy czas odczytow z bufora `source` (etap IO
+// w RunStats) i liczy przeczytane bajty. Przewijanie jest przekazywane dalej.
+class TimedInputBuffer : public std::streambuf {
+public:
+    TimedInputBuffer(std::streambuf* source_buffer, RunStats* run_stats)
+        : source(source_buffer), stats(run_stats), buffer(CHUNK) {
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+    // Liczba bajtow przeczytanych ze zrodla.
+    std::uint64_t bytes_read() const {
+        return total;
+    }
+
+protected:
+    int_type underflow() override {
+        if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+        std::streamsize n = read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        if (n <= 0) return traits_type::eof();
+        setg(buffer.data(), buffer.data(), buffer.data() + n);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    std::streamsize xsgetn(char* s, std::streamsize n) override {
+        std::streamsize done = std::min<std::streamsize>(n, egptr() - gptr());
+        std::memcpy(s, gptr(), static_cast<std::size_t>(done));
+        gbump(static_cast<int>(done));
+        // Duze odczyty omijaja bufor.
+        if (n - done >= static_cast<std::streamsize>(buffer.size())) {
+            std::streamsize direct = read(s + done, n - done);
+            return done + (direct > 0 ? direct : 0);
+        }
+        while (done < n && underflow() != traits_type::eof()) {
+            std::streamsize part = std::min<std::streamsize>(n - done, egptr() - gptr());
+            std::memcpy(s + done, gptr(), static_cast<std::size_t>(part));
+            gbump(static_cast<int>(part));
+            done += part;
+        }
+        return done;
+    }
+
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override {
+        off_type buffered = egptr() - gptr();
+        if (dir == std::ios_base::cur) {
+            pos_type position = source->pubseekoff(0, std::ios_base::cur, which);
+            if (position == pos_type(off_type(-1))) return position;
+            if (off == 0) return position - buffered;
+            off -= buffered;
+        }
+        setg(buffer.data(), buffer.data(), buffer.data());
+        return source->pubseekoff(off, dir, which);
+    }
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+        setg(buffer.data(), buffer.data(), buffer.data());
+        return source->pubseekpos(pos, which);
+    }
+
+private:
+    static constexpr std::size_t CHUNK = 64 * 1024;
+    std::streambuf* source;
+    RunStats* stats;
+    std::vector<char> buffer;
+    std::uint64_t total = 0;
+
+    std::streamsize read(char* s, std::streamsize n) {
+        PhaseTimer timer(stats, RunStats::IO);
+        std::streamsize got = source->sgetn(s, n);
+        if (got > 0) total += static_cast<std::uint64_t>(got);
+        return got;
+    }
+};
+
+// Bufor posredniczacy, ktory mierzy czas zapisow do bufora `target` (etap IO
+// w RunStats) i liczy zapisane bajty.
+class TimedOutputBuffer : public std::streambuf {
+public:
+    TimedOutputBuffer(std::streambuf* target_buffer, RunStats* run_stats)
+        : target(target_buffer), stats(run_stats), buffer(CHUNK) {
+        setp(buffer.data(), buffer.data() + buffer.size());
+    }
+
+    // Liczba bajtow przekazanych do celu.
+    std::uint64_t bytes_written() const {
+        return total;
+    }
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (!flush_buffer()) return traits_type::eof();
+        if (ch != traits_type::eof()) {
+            *pptr() = traits_type::to_char_type(ch);
+            pbump(1);
+        }
+        return traits_type::not_eof(ch);
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        if (n <= epptr() - pptr()) {
+            std::memcpy(pptr(), s, static_cast<std::size_t>(n));
+            pbump(static_cast<int>(n));
+            return n;
+        }
+        if (!flush_buffer()) return 0;
+        if (n >= static_cast<std::streamsize>(buffer.size())) return write(s, n);
+        std::memcpy(pptr(), s, static_cast<std::size_t>(n));
+        pbump(static_cast<int>(n));
+        return n;
+    }
+
+    int sync() override {
+        if (!flush_buffer()) return -1;
+        PhaseTimer timer(stats, RunStats::IO);
+        return target->pubsync();
+    }
+
+private:
+    static constexpr std::size_t CHUNK = 64 * 1024;
+    std::streambuf* target;
+    RunStats* stats;
+    std::vector<char> buffer;
+    std::uint64_t total = 0;
+
+    std::streamsize write(const char* s, std::streamsize n) {
+        PhaseTimer timer(stats, RunStats::IO);
+        std::streamsize put = target->sputn(s, n);
+        if (put > 0) total += static_cast<std::uint64_t>(put);
+        return put;
+    }
+
+    bool flush_buffer() {
+        std::streamsize n = pptr() - pbase();
+        if (n != 0 && write(pbase(), n) != n) return false;
+        setp(buffer.data(), buffer.data() + buffer.size());
+        return true;
+    }
+};
+
+// Plik wejsciowy: przy IoMode::MMAP odwzorowany w pamieci (z madvise SEQUENTIAL),
+// a gdy odwzorowanie sie nie uda (potok, pusty plik, blad) - zwykly ifstream.
+// Sciezka "-" to stdin. Z `stats` odczyty ze strumienia sa mierzone (TimedInputBuffer).
+class InputFile {
+public:
+    InputFile(const std::string& path, IoMode mode, RunStats* stats = nullptr) {
+        open(path, mode);
+        if (stats) {
+            std::istream& source = memory_stream ? *memory_stream : *file_stream;
+            timed_buffer = std::make_unique<TimedInputBuffer>(source.rdbuf(), stats);
+            timed_stream = std::make_unique<std::istream>(timed_buffer.get());
+        }
+    }
+
+    InputFile(const InputFile&) = delete;
+    InputFile& operator=(const InputFile&) = delete;
+
+    ~InputFile() {
+        unmap();
+    }
+
+    std::istream& stream() {
+        if (timed_stream) return *timed_stream;
+        return memory_stream ? *memory_stream : *file_stream;
+    }
+
+    // Liczba bajtow przeczytanych przez stream() (tylko z `stats`) albo rozmiar odwzorowanego pliku.
+    std::uint64_t bytes_read() const {
+        if (mapped) return mapped_size;
+        return timed_buffer ? timed_buffer->bytes_read() : 0;
+    }
+
+    // Poczatek odwzorowanego pliku albo nullptr dla strumienia.
+    const std::uint8_t* data() const {
+        return mapped;
+    }
+
+    // Rozmiar odwzorowanego pliku (0 dla strumienia).
+    std::uint64_t size() const {
+        return mapped_size;
+    }
+
+private:
+    std::unique_ptr<std::ifstream> file_stream;
+    std::unique_ptr<MemoryInputBuffer> buffer;
+    std::unique_ptr<StdinBuffer> stdin_buffer;
+    std::unique_ptr<std::istream> memory_stream;
+    std::unique_ptr<TimedInputBuffer> timed_buffer;
+    std::unique_ptr<std::istream> timed_stream;
+    const std::uint8_t* mapped = nullptr;
+    std::size_t mapped_size = 0;
+
+    void open(const std::string& path, IoMode mode) {
+        if (is_standard_stream(path)) {
+            stdin_buffer = std::make_unique<StdinBuffer>();
+            memory_stream = std::make_unique<std::istream>(stdin_buffer.get());
+            return;
+        }
+        if (mode == IoMode::MMAP && map(path)) {
+            buffer = std::make_unique<MemoryInputBuffer>(mapped, mapped_size);
+            memory_stream = std::make_unique<std::istream>(buffer.get());
+            return;
+        }
+        file_stream = std::make_unique<std::ifstream>(path, std::ios::binary);
+        if (!*file_stream) throw std::runtime_error("Nie mozna otworzyc pliku wejsciowego");
+    }
+
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+
+    // Odwzorowuje caly plik tylko do odczytu.
+    bool map(const std::string& path) {
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER size;
+        if (GetFileType(file) != FILE_TYPE_DISK || !GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+            unmap();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+        if (!view) {
+            unmap();
+            return false;
+        }
+        mapped = static_cast<const std::uint8_t*>(view);
+        mapped_size = static_cast<std::size_t>(size.QuadPart);
+        return true;
+    }
+
+    void unmap() {
+        if (mapped) UnmapViewOfFile(mapped);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapped = nullptr;
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+    }
+#else
+    // Odwzorowuje caly plik tylko do odczytu.
+    bool map(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode) || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void* view = ::mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) return false;
+        ::madvise(view, static_cast<std::size_t>(info.st_size), MADV_SEQUENTIAL);
+        mapped = static_cast<const std::uint8_t*>(view);
+        mapped_size = static_cast<std::size_t>(info.st_size);
+        return true;
+    }
+
+    void unmap() {
+        if (mapped) ::munmap(const_cast<std::uint8_t*>(mapped), mapped_size);
+        mapped = nullptr;
+    }
+#endif
+};
+
+// Bufor strumienia zapisujacy do pliku odwzorowanego w pamieci. Plik jest
+// powiekszany (rezerwacja blokow / nowe odwzorowanie) podwajaniem, a przy zamknieciu
+// przycinany do liczby zapisanych bajtow. Bloki sa rezerwowane przed odwzorowaniem:
+// przy zapisie przez odwzorowanie do pliku rzadkiego brak miejsca na dysku konczy
+// proces sygnalem SIGBUS zamiast bledu zapisu.
+class MappedOutputBuffer : public std::streambuf {
+public:
+    // Otwiera plik i rezerwuje `capacity` bajtow; false, gdy odwzorowanie sie nie uda.
+    bool open(const std::string& path, std::uint64_t capacity) {
+#if defined(_WIN32)
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+#else
+        fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        struct stat info;
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+            ::close(fd);
+            fd = -1;
+            return false;
+        }
+#endif
+        return remap(capacity < MIN_CAPACITY ? MIN_CAPACITY : capacity);
+    }
+
+    // Odmapowuje plik i przycina go do zapisanej dlugosci.
+    void close() {
+#if defined(_WIN32)
+        if (file == INVALID_HANDLE_VALUE) return;
+        release_view();
+        LARGE_INTEGER size;
+        size.QuadPart = static_cast<LONGLONG>(written);
+        bool ok = SetFilePointerEx(file, size, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+        CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (fd < 0) return;
+        release_view();
+        bool ok = ::ftruncate(fd, static_cast<off_t>(written)) == 0;
+        ::close(fd);
+        fd = -1;
+#endif
+        if (!ok) throw std::runtime_error("Blad zapisu pliku wyjsciowego");
+    }
+
+    ~MappedOutputBuffer() override {
+        try {
+            close();
+        } catch (...) {
+        }
+    }
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        std::uint64_t needed = written + static_cast<std::uint64_t>(n);
+        if (needed > capacity && !remap(needed > capacity * 2 ? needed : capacity * 2)) {
+            return 0;
+        }
+        std::memcpy(view + written, s, static_cast<std::size_t>(n));
+        written = needed;
+        return n;
+    }
+
+    int_type overflow(int_type ch) override {
+        if (ch == traits_type::eof()) return ch;
+        char c = static_cast<char>(ch);
+        return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+    }
+
+private:
+    static constexpr std::uint64_t MIN_CAPACITY = 64 * 1024;
+
+    std::uint8_t* view = nullptr;
+    std::uint64_t capacity = 0;
+    std::uint64_t written = 0;
+
+#if defined(_WIN32)
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+
+    bool remap(std::uint64_t new_capacity) {
+        release_view();
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, static_cast<DWORD>(new_capacity >> 32),
+                                     static_cast<DWORD>(new_capacity), nullptr);
+        void* mapped = mapping ? MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0) : nullptr;
+        if (!mapped) return false;
+        view = static_cast<std::uint8_t*>(mapped);
+        capacity = new_capacity;
+        return true;
+    }
+
+    void release_view() {
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        view = nullptr;
+        mapping = nullptr;
+    }
+#else
+    int fd = -1;
+
+    bool remap(std::uint64_t new_capacity) {
+        release_view();
+        if (!reserve(new_capacity)) return false;
+        void* mapped = ::mmap(nullptr, static_cast<std::size_t>(new_capacity), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapped == MAP_FAILED) return false;
+        view = static_cast<std::uint8_t*>(mapped);
+        capacity = new_capacity;
+        return true;
+    }
+
+    // Rezerwuje bloki dysku dla bajtow [capacity, new_capacity) i wydluza plik.
+    bool reserve(std::uint64_t new_capacity) {
+        const off_t offset = static_cast<off_t>(capacity);
+        const off_t length = static_cast<off_t>(new_capacity - capacity);
+#if defined(__APPLE__)
+        fstore_t store = {F_ALLOCATEALL, F_PEOFPOSMODE, 0, length, 0};
+        if (::fcntl(fd, F_PREALLOCATE, &store) == -1) return false;
+        return ::ftruncate(fd, offset + length) == 0;
+#else
+        return ::posix_fallocate(fd, offset, length) == 0;
+#endif
+    }
+
+    void release_view() {
+        if (view) ::munmap(view, static_cast<std::size_t>(capacity));
+        view = nullptr;
+    }
+#endif
+};
+
+// Plik wyjsciowy: przy IoMode::MMAP zapis przez odwzorowanie w pamieci
+// (rezerwacja `size_hint` bajtow), w przeciwnym razie - lub gdy sie nie uda - ofstream.
+// Sciezka "-" to stdout. Z `stats` zapisy sa mierzone (TimedOutputBuffer).
+class OutputFile {
+public:
+    OutputFile(const std::string& path, IoMode mode, std::uint64_t size_hint = 0, RunStats* stats = nullptr)
+        : run_stats(stats) {
+        open(path, mode, size_hint);
+        if (stats) {
+            std::ostream& target = memory_stream ? *memory_stream : *file_stream;
+            timed_buffer = std::make_unique<TimedOutputBuffer>(target.rdbuf(), stats);
+            timed_stream = std::make_unique<std::ostream>(timed_buffer.get());
+        }
+    }
+
+    std::ostream& stream() {
+        if (timed_stream) return *timed_stream;
+        return memory_stream ? *memory_stream : *file_stream;
+    }
+
+    // Liczba zapisanych bajtow (tylko z `stats`).
+    std::uint64_t bytes_written() const {
+        return timed_buffer ? timed_buffer->bytes_written() : 0;
+    }
+
+    // Konczy zapis; bledy zapisu zglaszane sa wyjatkiem.
+    void close() {
+        if (timed_stream && !timed_stream->flush()) throw std::runtime_error("Blad zapisu pliku wyjsciowego");
+        PhaseTimer timer(run_stats, RunStats::IO);
+        if (stdout_buffer) {
+            if (!memory_stream->flush()) throw std::runtime_error("Blad zapisu pliku wyjsciowego");
+            return;
+        }
+        if (buffer) {
+            if (!*memory_stream) throw std::runtime_error("Blad zapisu pliku wyjsciowego");
+            buffer->close();
+            return;
+        }
+        file_stream->close();
+        if (!*file_stream) throw std::runtime_error("Blad zapisu pliku wyjsciowego");
+    }
+
+private:
+    std::unique_ptr<std::ofstream> file_stream;
+    std::unique_ptr<MappedOutputBuffer> buffer;
+    std::unique_ptr<StdoutBuffer> stdout_buffer;
+    std::unique_ptr<std::ostream> memory_stream;
+    std::unique_ptr<TimedOutputBuffer> timed_buffer;
+    std::unique_ptr<std::ostream> timed_stream;
+    RunStats* run_stats;
+
+    void open(const std::string& path, IoMode mode, std::uint64_t size_hint) {
+        if (is_standard_stream(path)) {
+            stdout_buffer = std::make_unique<StdoutBuffer>();
+            memory_stream = std::make_unique<std::ostream>(stdout_buffer.get());
+            return;
+        }
+        if (mode == IoMode::MMAP) {
+            buffer = std::make_unique<MappedOutputBuffer>();
+            if (buffer->open(path, size_hint)) {
+                memory_stream = std::make_unique<std::ostream>(buffer.get());
+                return;
+            }
+            buffer.reset();
+        }
+        file_stream = std::make_unique<std::ofstream>(path, std::ios::binary | std::ios::trunc);
+        if (!*file_stream) throw std::runtime_error("Nie mozna otworzyc pliku wyjsciowego");
+    }
+};
@@ -0,0 +1,723 @@
+#pragma once
+
+#include "huffman_tree.h"
+#include "canonical_codes.h"
+#include "context_model.h"
+#include "decode_table.h"
+#include "bit_writer.h"
+#include "payload_source.h"
+#include "huff_format.h"
+#include "byte_counter.h"
+#include "crc32c.h"
+#include "length_limited_codes.h"
+#include "run_stats.h"
+#include "shared_table.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+// Ustawienia kodowania blokow (wspolne dla plikow i buforow w pamieci).
+struct CodecOptions {
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1024 * 1024;
+    // Probkowanie histogramu: domyslny i najwiekszy dzielnik oraz dlugosc odcinka probki.
+    static constexpr unsigned DEFAULT_SAMPLE = 8;
+    static constexpr unsigned MAX_SAMPLE = 256;
+    static constexpr size_t SAMPLE_CHUNK = 4096;
+
+    size_t block_size = DEFAULT_BLOCK_SIZE;
+    // Najdluzszy dozwolony kod (0 - bez ograniczenia).
+    unsigned max_code_length = 0;
+    // Liczba przeplatanych strumieni bitow w bloku (1 - jeden strumien).
+    unsigned streams = 1;
+    // Model rzedu 1: osobne kody dla grup kontekstow (poprzedniego bajtu), bez przeplatania strumieni.
+    bool order1 = false;
+    // Blok jest zapisywany bez kodowania, gdy kod Huffmana (z tablicami kodow) nie
+    // zmniejsza go o co najmniej tyle procent (0-99).
+    unsigned min_gain = 1;
+    // Suma kontrolna CRC-32C danych kazdego bloku, sprawdzana przy dekompresji.
+    bool checksum = false;
+    // Histogram z probki: co `sample`-ty odcinek SAMPLE_CHUNK bajtow bloku (0 lub 1 - caly
+    // blok). Kazdy bajt dostaje kod, wiec blok jest kodowany bez drugiego przebiegu zliczania.
+    unsigned sample = 0;
+    // Pomiary etapow i rozmiarow (nullptr - bez pomiarow).
+    RunStats* stats = nullptr;
+};
+
+// Podsumowanie kompresji.
+struct CompressionReport {
+    uint64_t input_size = 0;
+    // Rozmiar danych Huffmana w bitach (bez naglowkow blokow).
+    uint64_t payload_bits = 0;
+    // Rozmiar, jaki mialyby dane przy kodach bez ograniczenia dlugosci.
+    uint64_t unlimited_payload_bits = 0;
+    unsigned longest_code = 0;
+
+    // Dolicza podsumowanie kolejnego bloku.
+    void add(const CompressionReport& block) {
+        input_size += block.input_size;
+        payload_bits += block.payload_bits;
+        unlimited_payload_bits += block.unlimited_payload_bits;
+        longest_code = std::max(longest_code, block.longest_code);
+    }
+};
+
+// Pamiec wielokrotnego uzytku dla HuffCodec: histogram, kody, tablica dekodujaca
+// i bufory strumieni. Drzewo ma stala tablice wezlow i jest budowane na stosie.
+// Po pierwszym wywolaniu kolejne wywolania dla podobnych danych nie alokuja
+// pamieci (takze przy ograniczeniu dlugosci kodow i modelu rzedu 1). Kontekstu
+// moze uzywac naraz tylko jeden watek.
+class HuffContext {
+public:
+    HuffContext() : decode_table(CodeTable{}) {}
+
+    // Podsumowanie ostatniej kompresji.
+    const CompressionReport& report() const {
+        return last_report;
+    }
+
+private:
+    friend class HuffCodec;
+
+    ByteHistogram histogram{};
+    CodeLengths lengths{};
+    CodeTable codes{};
+    DecodeTable decode_table;
+    std::array<std::vector<uint8_t>, HuffFormat::MAX_STREAMS> streams;
+    std::vector<BitWriter> writers;
+    CompressionReport last_report;
+    // Model rzedu 1 (alokowany przy pierwszym uzyciu): liczniki par bajtow, tablice grup i kody grup.
+    std::vector<uint32_t> context_counts;
+    ContextTables context_tables;
+    std::vector<CodeTable> context_codes;
+    std::vector<DecodeTable> context_decoders;
+    // Pamiec budowy modelu rzedu 1 i package-merge (takze dla kodow rzedu 0).
+    ContextModel::Buffers model_buffers;
+};
+
+// Kompresja i dekompresja buforow w pamieci. Wynik compress ma format pliku .huff
+// (kontener blokowy bez indeksu), a decompress przyjmuje pliki w formacie blokowym.
+// Wersje z SharedTable koduja wspolna tablica kodow (format VERSION_SHARED).
+// Bledy sa zglaszane wyjatkami std::runtime_error, tak jak dla plikow.
+class HuffCodec {
+public:
+    // Najwiekszy rozmiar wyniku compress dla `size` bajtow wejscia.
+    static size_t compress_bound(size_t size, const CodecOptions& options = CodecOptions{}) {
+        check_options(options);
+        size_t full_blocks = size / options.block_size;
+        size_t rest = size % options.block_size;
+        return static_cast<size_t>(HuffFormat::FIRST_BLOCK_OFFSET)
+            + full_blocks * block_bound(options.block_size, options.streams, options.order1)
+            + (rest != 0 ? block_bound(rest, options.streams, options.order1) : 0)
+            + 1;
+    }
+
+    // Najwiekszy rozmiar zakodowanego bloku `size` bajtow. Kod Huffmana (takze
+    // z ograniczeniem dlugosci do co najmniej 8 bitow) nie jest gorszy od kodu
+    // 8-bitowego, wiec dane zajmuja najwyzej `size` bajtow i po bajcie dopelnienia
+    // na strumien; reszta to naglowek bloku i tablica strumieni. Model rzedu 1
+    // (`order1`) ma wiekszy naglowek z tablicami wszystkich grup. Blok zapisany
+    // bez kodowania jest mniejszy.
+    static size_t block_bound(size_t size, unsigned streams = 1, bool order1 = false) {
+        size_t tables = order1 ? HuffFormat::MAX_BLOCK_TABLES_SIZE
+                               : HuffFormat::CHECKSUM_SIZE + 1 + HuffFormat::MAX_CODE_LENGTHS_SIZE;
+        size_t header = 2 * HuffFormat::MAX_VARINT_SIZE + tables + 1;
+        size_t stream_table = streams > 1 ? 1 + (streams - 1) * HuffFormat::MAX_VARINT_SIZE : 0;
+        return header + stream_table + size + streams;
+    }
+
+    // Kompresuje `size` bajtow do `dst` o pojemnosci `capacity` (wystarczy compress_bound).
+    // Zwraca rozmiar wyniku; podsumowanie jest w context.report().
+    static size_t compress(HuffContext& context, const uint8_t* src, size_t size,
+                           uint8_t* dst, size_t capacity, const CodecOptions& options = CodecOptions{}) {
+        check_options(options);
+        uint8_t* p = dst;
+        const uint8_t* end = dst + capacity;
+        for (char c : HuffFormat::MAGIC) HuffFormat::put_byte(p, end, static_cast<uint8_t>(c));
+        HuffFormat::put_byte(p, end, static_cast<uint8_t>(HuffFormat::VERSION_BLOCKS));
+        HuffFormat::put_byte(p, end, container_flags(options));
+
+        CompressionReport report;
+        for (size_t offset = 0; offset < size; offset += options.block_size) {
+            size_t block = std::min(options.block_size, size - offset);
+            p += compress_block(context, src + offset, block, options, p, static_cast<size_t>(end - p));
+            report.add(context.last_report);
+        }
+        HuffFormat::write_varint(p, end, 0);
+        context.last_report = report;
+        return static_cast<size_t>(p - dst);
+    }
+
+    // Kompresuje do wektora; jego pojemnosc zostaje do kolejnych wywolan.
+    static void compress(HuffContext& context, const uint8_t* src, size_t size,
+                         std::vector<uint8_t>& out, const CodecOptions& options = CodecOptions{}) {
+        out.resize(compress_bound(size, options));
+        out.resize(compress(context, src, size, out.data(), out.size(), options));
+    }
+
+    // Rozmiar danych po dekompresji (suma rozmiarow blokow), bez dekodowania.
+    static uint64_t decompressed_size(const uint8_t* src, size_t size) {
+        const uint8_t* p = src;
+        const uint8_t* end = src + size;
+        if (read_signature(p, end) == HuffFormat::VERSION_SHARED) {
+            HuffFormat::read_u32(p, end);
+            return HuffFormat::read_varint(p, end);
+        }
+        p = src;
+        const uint8_t flags = read_container_header(p, end);
+        uint64_t total = 0;
+        while (true) {
+            uint64_t raw_size = HuffFormat::read_varint(p, end);
+            if (raw_size == 0) return total;
+            HuffFormat::read_block_tables(p, end, flags);
+            uint64_t payload_size = HuffFormat::read_varint(p, end);
+            read_padding(p, end);
+            skip_payload(p, end, payload_size);
+            total += raw_size;
+        }
+    }
+
+    // Dekompresuje plik w formacie blokowym z `src` do `dst` o pojemnosci `capacity`
+    // (wystarczy decompressed_size). Zwraca liczbe bajtow wyniku.
+    static size_t decompress(HuffContext& context, const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+        const uint8_t* p = src;
+        const uint8_t* end = src + size;
+        const uint8_t flags = read_container_header(p, end);
+        const bool interleaved = (flags & HuffFormat::FLAG_STREAMS) != 0;
+        const bool order1 = (flags & HuffFormat::FLAG_ORDER1) != 0;
+        size_t produced = 0;
+        while (true) {
+            uint64_t raw_size = HuffFormat::read_varint(p, end);
+            if (raw_size == 0) return produced;
+            context.context_tables = HuffFormat::read_block_tables(p, end, flags);
+            uint64_t payload_size = HuffFormat::read_varint(p, end);
+            uint8_t padding = read_padding(p, end);
+            const uint8_t* payload = p;
+            skip_payload(p, end, payload_size);
+            if (raw_size > capacity - produced) throw std::runtime_error("Za maly bufor wyjsciowy");
+
+            uint8_t* raw = dst + produced;
+            if (context.context_tables.stored) {
+                copy_stored_block(payload, static_cast<size_t>(payload_size), padding, raw_size, raw);
+            } else if (order1) {
+                build_context_decoders(context.context_tables, context.context_decoders);
+                decode_context_block(context.context_tables, context.context_decoders, payload,
+                                     static_cast<size_t>(payload_size), padding, raw_size, raw);
+            } else {
+                context.decode_table.rebuild(CanonicalCodes::from_lengths(context.context_tables.lengths[0]));
+                if (interleaved) {
+                    decode_streams_block(context.decode_table, payload, static_cast<size_t>(payload_size), padding,
+                                         raw_size, raw);
+                } else {
+                    if (payload_size == 0 && padding != 0) throw std::runtime_error("Niepoprawny padding");
+                    MemoryPayloadSource source(payload, static_cast<size_t>(payload_size), payload_size * 8 - padding);
+                    if (context.decode_table.decode(source, raw, capacity - produced) != raw_size) {
+                        throw std::runtime_error("Niepoprawny rozmiar bloku");
+                    }
+                }
+            }
+            // Blok jest jeszcze w pamieci podrecznej - suma kontrolna nie czyta go ponownie z pamieci.
+            verify_checksum(context.context_tables, flags, raw, static_cast<size_t>(raw_size));
+            produced += static_cast<size_t>(raw_size);
+        }
+    }
+
+    // Dekompresuje do wektora o rozmiarze danych po dekompresji.
+    static void decompress(HuffContext& context, const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+        out.resize(static_cast<size_t>(decompressed_size(src, size)));
+        decompress(context, src, size, out.data(), out.size());
+    }
+
+    // Najwiekszy rozmiar wyniku compress ze wspolna tablica `table` dla `size` bajtow:
+    // sygnatura, identyfikator tablicy, rozmiar, padding i kody najwyzej table.longest() bitow.
+    static size_t compress_bound(size_t size, const SharedTable& table) {
+        return static_cast<size_t>(sizeof(HuffFormat::MAGIC)) + 1 + 4 + HuffFormat::MAX_VARINT_SIZE + 1
+            + size / 8 * table.longest() + table.longest();
+    }
+
+    // Kompresuje `size` bajtow wspolna tablica kodow w jednym przebiegu: bez zliczania
+    // bajtow, budowy drzewa i tablicy kodow w wyniku. Zwraca rozmiar wyniku.
+    static size_t compress(const SharedTable& table, const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+        uint8_t* p = dst;
+        const uint8_t* end = dst + capacity;
+        for (char c : HuffFormat::MAGIC) HuffFormat::put_byte(p, end, static_cast<uint8_t>(c));
+        HuffFormat::put_byte(p, end, static_cast<uint8_t>(HuffFormat::VERSION_SHARED));
+        HuffFormat::write_u32(p, end, table.id());
+        HuffFormat::write_varint(p, end, size);
+        // Padding jest znany dopiero po zakodowaniu danych.
+        uint8_t* padding = p;
+        HuffFormat::put_byte(p, end, 0);
+        BitWriter writer(p, static_cast<size_t>(end - p));
+        *padding = write_bits(src, size, table.code_table(), writer);
+        return static_cast<size_t>(p - dst + writer.bytes_written());
+    }
+
+    // Kompresuje wspolna tablica do wektora; jego pojemnosc zostaje do kolejnych wywolan.
+    static void compress(const SharedTable& table, const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+        out.resize(compress_bound(size, table));
+        out.resize(compress(table, src, size, out.data(), out.size()));
+    }
+
+    // Dekompresuje dane zapisane przez compress z ta sama tablica `table` do `dst`
+    // o pojemnosci `capacity` (wystarczy decompressed_size). Zwraca liczbe bajtow wyniku.
+    static size_t decompress(const SharedTable& table, const uint8_t* src, size_t size, uint8_t* dst, size_t capacity) {
+        const uint8_t* p = src;
+        const uint8_t* end = src + size;
+        if (read_signature(p, end) != HuffFormat::VERSION_SHARED) {
+            throw std::runtime_error("Plik nie zostal skompresowany wspolna tablica kodow");
+        }
+        return decode_shared(table, p, end, dst, capacity);
+    }
+
+    // Dekompresuje wspolna tablica do wektora o rozmiarze danych po dekompresji.
+    static void decompress(const SharedTable& table, const uint8_t* src, size_t size, std::vector<uint8_t>& out) {
+        out.resize(static_cast<size_t>(decompressed_size(src, size)));
+        decompress(table, src, size, out.data(), out.size());
+    }
+
+    // Czyta naglowek danych VERSION_SHARED za bajtem wersji ([p, end)): sprawdza
+    // identyfikator tablicy i zwraca rozmiar danych po dekompresji oraz `padding`.
+    // `p` wskazuje potem strumien bitow, ktory konczy sie w `end`.
+    static uint64_t read_shared_header(const SharedTable& table, const uint8_t*& p, const uint8_t* end,
+                                       uint8_t& padding) {
+        if (HuffFormat::read_u32(p, end) != table.id()) {
+            throw std::runtime_error("Plik zostal skompresowany inna wspolna tablica kodow");
+        }
+        uint64_t raw_size = HuffFormat::read_varint(p, end);
+        padding = read_padding(p, end);
+        // Kazdy kod ma co najmniej 1 bit, wiec rozmiar danych jest ograniczony strumieniem.
+        if ((p == end && padding != 0) || raw_size > static_cast<uint64_t>(end - p) * 8) {
+            throw std::runtime_error("Niepoprawny naglowek pliku");
+        }
+        return raw_size;
+    }
+
+    // Dekoduje dane VERSION_SHARED zaczynajace sie za bajtem wersji do `dst`. Zwraca liczbe bajtow.
+    static size_t decode_shared(const SharedTable& table, const uint8_t* p, const uint8_t* end,
+                                uint8_t* dst, size_t capacity) {
+        uint8_t padding = 0;
+        uint64_t raw_size = read_shared_header(table, p, end, padding);
+        if (raw_size > capacity) throw std::runtime_error("Za maly bufor wyjsciowy");
+        const size_t payload_size = static_cast<size_t>(end - p);
+        MemoryPayloadSource source(p, payload_size, static_cast<uint64_t>(payload_size) * 8 - padding);
+        if (table.decode_table().decode(source, dst, static_cast<size_t>(raw_size)) != raw_size) {
+            throw std::runtime_error("Niepoprawny rozmiar danych");
+        }
+        return static_cast<size_t>(raw_size);
+    }
+
+    // Koduje jeden blok (naglowek bloku i dane) do `dst`. Gdy drzewo daje kody
+    // dluzsze niz `max_code_length`, dlugosci sa wyznaczane od nowa z ograniczeniem
+    // (package-merge). Przy kilku strumieniach dane bloku to tablica strumieni
+    // i strumienie (patrz HuffFormat::write_streams). Blok, ktorego kod nie zmniejsza
+    // o `min_gain` procent, jest zapisywany bez kodowania. Zwraca rozmiar bloku.
+    static size_t compress_block(HuffContext& context, const uint8_t* data, size_t size,
+                                 const CodecOptions& options, uint8_t* dst, size_t capacity) {
+        if (options.order1) return compress_context_block(context, data, size, options, dst, capacity);
+        const bool sampled = is_sampled(size, options);
+        const size_t written = compress_order0_block(context, data, size, sampled, options, dst, capacity);
+        if (sampled && options.stats) {
+            // Strata probkowania wymaga pelnego histogramu - jest liczony tylko przy pomiarach.
+            ByteHistogram exact{};
+            ByteCounter::count(data, size, exact);
+            options.stats->add_entropy(exact);
+            options.stats->add_sampling(exact_payload_bits(exact, size, options), context.last_report.payload_bits);
+        }
+        return written;
+    }
+
+    // Czy histogram bloku `size` bajtow jest liczony z probki. Krotkie bloki sa liczone w calosci.
+    static bool is_sampled(size_t size, const CodecOptions& options) {
+        return options.sample > 1 && size / options.sample >= CodecOptions::SAMPLE_CHUNK;
+    }
+
+    // Histogram z probki: co `sample`-ty odcinek SAMPLE_CHUNK bajtow, przeskalowany do
+    // rozmiaru bloku. Bajty spoza probki dostaja licznik 1, wiec kazdy ma kod - probka
+    // moze ominac rzadkie bajty, a blok jest kodowany bez ponownego zliczania.
+    static void sample_histogram(const uint8_t* data, size_t size, unsigned sample, ByteHistogram& histogram) {
+        const size_t stride = CodecOptions::SAMPLE_CHUNK * sample;
+        size_t counted = 0;
+        for (size_t offset = 0; offset < size; offset += stride) {
+            const size_t chunk = std::min(CodecOptions::SAMPLE_CHUNK, size - offset);
+            ByteCounter::count(data + offset, chunk, histogram);
+            counted += chunk;
+        }
+        const double scale = static_cast<double>(size) / static_cast<double>(counted);
+        for (uint64_t& count : histogram) {
+            count = std::max<uint64_t>(1, static_cast<uint64_t>(static_cast<double>(count) * scale + 0.5));
+        }
+    }
+
+    // Rozmiar danych bloku w bitach przy kodach z pelnego histogramu `exact` (albo bez
+    // kodowania, gdy tak jest mniej), do porownania z kodami z probki.
+    static uint64_t exact_payload_bits(const ByteHistogram& exact, size_t size, const CodecOptions& options) {
+        CodeLengths lengths = CanonicalCodes::lengths_of(HuffmanTree::from_frequencies(exact).build_huffman_codes());
+        if (options.max_code_length != 0 && LengthLimitedCodes::longest(lengths) > options.max_code_length) {
+            lengths = LengthLimitedCodes::build(exact, options.max_code_length);
+        }
+        return std::min<uint64_t>(LengthLimitedCodes::encoded_bits(exact, lengths), static_cast<uint64_t>(size) * 8);
+    }
+
+    // Koduje blok jednymi kodami (model rzedu 0). Przy `sampled` histogram jest z probki,
+    // wiec rozmiar danych jest znany dopiero po zakodowaniu - strumien trafia najpierw
+    // do bufora kontekstu, a blok, ktory wbrew probce sie nie zmniejszyl, jest zapisywany
+    // bez kodowania.
+    static size_t compress_order0_block(HuffContext& context, const uint8_t* data, size_t size, bool sampled,
+                                        const CodecOptions& options, uint8_t* dst, size_t capacity) {
+        ByteHistogram& frequencies = context.histogram;
+        uint32_t checksum = 0;
+        {
+            PhaseTimer timer(options.stats, RunStats::HISTOGRAM);
+            frequencies.fill(0);
+            if (sampled) {
+                sample_histogram(data, size, options.sample, frequencies);
+            } else {
+                ByteCounter::count(data, size, frequencies);
+            }
+            if (options.checksum) checksum = Crc32c::compute(data, size);
+        }
+        if (options.stats && !sampled) options.stats->add_entropy(frequencies);
+
+        CodeLengths& lengths = context.lengths;
+        CompressionReport& report = context.last_report;
+        ContextTables& tables = context.context_tables;
+        const uint8_t flags = container_flags(options);
+        bool coded = false;
+        {
+            PhaseTimer timer(options.stats, RunStats::TREE);
+            // Entropia ogranicza z dolu rozmiar danych po kodowaniu - blok, ktory nie moze
+            // sie dosc zmniejszyc (np. dane juz skompresowane), nie potrzebuje drzewa.
+            if (worth_coding(size, 1 + ByteCounter::entropy_bits(frequencies.data(), frequencies.size()) / 8, options)) {
+                lengths = CanonicalCodes::lengths_of(HuffmanTree::from_frequencies(frequencies).build_huffman_codes());
+                report = CompressionReport{};
+                report.input_size = size;
+                report.unlimited_payload_bits = LengthLimitedCodes::encoded_bits(frequencies, lengths);
+                if (options.max_code_length != 0 && LengthLimitedCodes::longest(lengths) > options.max_code_length) {
+                    lengths = LengthLimitedCodes::build(frequencies, options.max_code_length,
+                                                        context.model_buffers.package_merge);
+                }
+                report.payload_bits = LengthLimitedCodes::encoded_bits(frequencies, lengths);
+                report.longest_code = LengthLimitedCodes::longest(lengths);
+                tables.stored = false;
+                tables.count = 1;
+                tables.lengths[0] = lengths;
+                coded = worth_coding(size, static_cast<double>(coded_size(tables, flags, report.payload_bits)), options);
+                if (coded) context.codes = CanonicalCodes::from_lengths(lengths);
+            }
+        }
+        if (!coded) return compress_stored_block(context, data, size, checksum, options, dst, capacity);
+        tables.checksum = checksum;
+
+        PhaseTimer timer(options.stats, RunStats::CODING);
+        uint8_t* p = dst;
+        const uint8_t* end = dst + capacity;
+        HuffFormat::write_varint(p, end, size);
+        HuffFormat::write_block_tables(p, end, tables, flags);
+
+        if (options.streams <= 1 && !sampled) {
+            // Rozmiar danych wynika z histogramu, wiec strumien bitow trafia od razu na miejsce.
+            uint64_t payload_size = (report.payload_bits + 7) / 8;
+            HuffFormat::write_varint(p, end, payload_size);
+            HuffFormat::put_byte(p, end, static_cast<uint8_t>(payload_size * 8 - report.payload_bits));
+            if (payload_size > static_cast<uint64_t>(end - p)) throw std::runtime_error("Za maly bufor wyjsciowy");
+            context.writers.clear();
+            context.writers.emplace_back(p, static_cast<size_t>(payload_size));
+            write_bits(data, size, context.codes, context.writers);
+            if (options.stats) options.stats->add_block(size, payload_size, report.payload_bits, report.longest_code);
+            return static_cast<size_t>(p + payload_size - dst);
+        }
+
+        // Podzial bitow miedzy strumienie nie wynika z histogramu - strumienie sa
+        // kodowane do buforow kontekstu i kopiowane za tablica strumieni. Bez probki
+        // strumien nie jest dluzszy niz dane calego bloku po kodowaniu. Przy probce bufor
+        // ma rozmiar danych strumienia bez kodowania (z zapasem na dopelnienie) - strumien,
+        // ktory sie w nim nie miesci, nie jest wart kodowania.
+        const unsigned count = std::max(options.streams, 1u);
+        const size_t stream_symbols = (size + count - 1) / count;
+        const size_t stream_capacity = std::min<uint64_t>(
+            (static_cast<uint64_t>(stream_symbols) * report.longest_code + 7) / 8,
+            sampled ? stream_symbols + 8 : (report.payload_bits + 7) / 8);
+        context.writers.clear();
+        for (unsigned k = 0; k < count; ++k) {
+            if (context.streams[k].size() < stream_capacity) context.streams[k].resize(stream_capacity);
+            context.writers.emplace_back(context.streams[k].data(), stream_capacity);
+        }
+        uint8_t padding = 0;
+        try {
+            if (count == 1) {
+                padding = write_bits(data, size, context.codes, context.writers[0]);
+            } else {
+                write_bits(data, size, context.codes, context.writers);
+            }
+        } catch (const std::runtime_error&) {
+            // Kody z probki maja kazdy bajt, wiec wyjatek to tylko przepelnienie bufora strumienia.
+            if (!sampled) throw;
+            return compress_stored_block(context, data, size, checksum, options, dst, capacity);
+        }
+
+        const uint8_t* streams[HuffFormat::MAX_STREAMS];
+        size_t sizes[HuffFormat::MAX_STREAMS];
+        uint64_t payload_size = 0;
+        for (unsigned k = 0; k < count; ++k) {
+            streams[k] = context.streams[k].data();
+            sizes[k] = static_cast<size_t>(context.writers[k].bytes_written());
+            payload_size += sizes[k];
+        }
+        if (sampled) {
+            // Przy kilku strumieniach dopelnienie strumieni (do 7 bitow) jest wliczane.
+            report.payload_bits = payload_size * 8 - padding;
+            report.unlimited_payload_bits = report.payload_bits;
+            if (!worth_coding(size, static_cast<double>(coded_size(tables, flags, report.payload_bits)), options)) {
+                return compress_stored_block(context, data, size, checksum, options, dst, capacity);
+            }
+        }
+        if (options.stats) options.stats->add_block(size, payload_size, report.payload_bits, report.longest_code);
+        if (count == 1) {
+            HuffFormat::write_varint(p, end, payload_size);
+            HuffFormat::put_byte(p, end, padding);
+            if (payload_size > static_cast<uint64_t>(end - p)) throw std::runtime_error("Za maly bufor wyjsciowy");
+            std::copy(streams[0], streams[0] + sizes[0], p);
+            return static_cast<size_t>(p + payload_size - dst);
+        }
+        HuffFormat::write_varint(p, end, HuffFormat::streams_size(sizes, count));
+        HuffFormat::put_byte(p, end, 0);
+        HuffFormat::write_streams(p, end, streams, sizes, count);
+        return static_cast<size_t>(p - dst);
+    }
+
+    // Koduje blok modelem rzedu 1: naglowek bloku z tablicami grup (patrz
+    // HuffFormat::write_block_tables) i jeden strumien bitow. Zwraca rozmiar bloku.
+    static size_t compress_context_block(HuffContext& context, const uint8_t* data, size_t size,
+                                         const CodecOptions& options, uint8_t* dst, size_t capacity) {
+        context.context_counts.resize(ContextModel::CONTEXT_COUNTS);
+        const uint32_t* counts = context.context_counts.data();
+        uint32_t checksum = 0;
+        {
+            PhaseTimer timer(options.stats, RunStats::HISTOGRAM);
+            ContextModel::count(data, size, context.context_counts.data());
+            if (options.checksum) checksum = Crc32c::compute(data, size);
+        }
+
+        ContextTables& tables = context.context_tables;
+        CompressionReport& report = context.last_report;
+        const uint8_t flags = container_flags(options);
+        bool coded = false;
+        {
+            PhaseTimer timer(options.stats, RunStats::TREE);
+            // Entropia warunkowa (suma entropii bajtow po kazdym kontekscie) ogranicza
+            // z dolu rozmiar danych dla kodow zaleznych od poprzedniego bajtu.
+            double entropy = 0.0;
+            for (size_t row = 0; row < 256; ++row) entropy += ByteCounter::entropy_bits(counts + row * 256, 256);
+            if (options.stats) options.stats->add_entropy_bits(entropy);
+            if (worth_coding(size, 1 + entropy / 8, options)) {
+                report = CompressionReport{};
+                report.input_size = size;
+                tables = ContextModel::build(counts, options.max_code_length, report.unlimited_payload_bits,
+                                             context.model_buffers);
+                report.payload_bits = ContextModel::encoded_bits(counts, tables);
+                report.longest_code = ContextModel::longest(tables);
+                coded = worth_coding(size, static_cast<double>(coded_size(tables, flags, report.payload_bits)), options);
+            }
+            if (coded) {
+                context.context_codes.resize(tables.count);
+                for (unsigned c = 0; c < tables.count; ++c) {
+                    context.context_codes[c] = CanonicalCodes::from_lengths(tables.lengths[c]);
+                }
+            }
+        }
+        if (!coded) return compress_stored_block(context, data, size, checksum, options, dst, capacity);
+        tables.checksum = checksum;
+
+        PhaseTimer timer(options.stats, RunStats::CODING);
+        uint8_t* p = dst;
+        const uint8_t* end = dst + capacity;
+        HuffFormat::write_varint(p, end, size);
+        HuffFormat::write_block_tables(p, end, tables, flags);
+        uint64_t payload_size = (report.payload_bits + 7) / 8;
+        HuffFormat::write_varint(p, end, payload_size);
+        HuffFormat::put_byte(p, end, static_cast<uint8_t>(payload_size * 8 - report.payload_bits));
+        if (payload_size > static_cast<uint64_t>(end - p)) throw std::runtime_error("Za maly bufor wyjsciowy");
+        BitWriter writer(p, static_cast<size_t>(payload_size));
+        ContextModel::write_bits(data, size, context.context_codes.data(), tables.cluster_of, writer);
+        if (options.stats) options.stats->add_block(size, payload_size, report.payload_bits, report.longest_code);
+        return static_cast<size_t>(p + payload_size - dst);
+    }
+
+    // Zapisuje blok bez kodowania: naglowek z typem BLOCK_STORED i bajty wejscia. Zwraca rozmiar bloku.
+    static size_t compress_stored_block(HuffContext& context, const uint8_t* data, size_t size, uint32_t checksum,
+                                        const CodecOptions& options, uint8_t* dst, size_t capacity) {
+        PhaseTimer timer(options.stats, RunStats::CODING);
+        CompressionReport& report = context.last_report;
+        report = CompressionReport{};
+        report.input_size = size;
+        report.payload_bits = static_cast<uint64_t>(size) * 8;
+        report.unlimited_payload_bits = report.payload_bits;
+        ContextTables& tables = context.context_tables;
+        tables.stored = true;
+        tables.count = 0;
+        tables.checksum = checksum;
+
+        uint8_t* p = dst;
+        const uint8_t* end = dst + capacity;
+        HuffFormat::write_varint(p, end, size);
+        HuffFormat::write_block_tables(p, end, tables, container_flags(options));
+        HuffFormat::write_varint(p, end, size);
+        HuffFormat::put_byte(p, end, 0);
+        if (size > static_cast<size_t>(end - p)) throw std::runtime_error("Za maly bufor wyjsciowy");
+        std::memcpy(p, data, size);
+        if (options.stats) options.stats->add_block(size, size, report.payload_bits, 0);
+        return static_cast<size_t>(p + size - dst);
+    }
+
+    // Sprawdza sume kontrolna `size` bajtow danych bloku, gdy kontener ja zawiera (`flags`).
+    static void verify_checksum(const ContextTables& tables, uint8_t flags, const uint8_t* raw, size_t size) {
+        if ((flags & HuffFormat::FLAG_CHECKSUM) && Crc32c::compute(raw, size) != tables.checksum) {
+            throw std::runtime_error("Niezgodna suma kontrolna bloku");
+        }
+    }
+
+    // Kopiuje dane bloku zapisanego bez kodowania do `raw` (raw_size bajtow).
+    static void copy_stored_block(const uint8_t* payload, size_t payload_size, uint8_t padding, uint64_t raw_size,
+                                  uint8_t* raw) {
+        if (padding != 0 || payload_size != raw_size) throw std::runtime_error("Niepoprawny naglowek bloku");
+        std::memcpy(raw, payload, payload_size);
+    }
+
+    // Buduje tablice dekodujace grup modelu rzedu 1 w `decoders` (pamiec do ponownego uzycia).
+    static void build_context_decoders(const ContextTables& tables, std::vector<DecodeTable>& decoders) {
+        while (decoders.size() < tables.count) decoders.emplace_back(CodeTable{}, ContextModel::TABLE_BITS);
+        for (unsigned c = 0; c < tables.count; ++c) {
+            decoders[c].rebuild(CanonicalCodes::from_lengths(tables.lengths[c]), ContextModel::TABLE_BITS);
+        }
+    }
+
+    // Dekoduje blok modelu rzedu 1 do `raw` (raw_size bajtow) tablicami z build_context_decoders.
+    static void decode_context_block(const ContextTables& tables, const std::vector<DecodeTable>& decoders,
+                                     const uint8_t* payload, size_t payload_size, uint8_t padding,
+                                     uint64_t raw_size, uint8_t* raw) {
+        if (raw_size > static_cast<uint64_t>(payload_size) * 8 || (payload_size == 0 && padding != 0)) {
+            throw std::runtime_error("Niepoprawny naglowek bloku");
+        }
+        DecodeTable::decode_context(decoders.data(), tables.cluster_of.data(), payload, payload_size,
+                                    static_cast<uint64_t>(payload_size) * 8 - padding, raw_size, raw);
+    }
+
+    // Dekoduje blok zapisany w kilku przeplatanych strumieniach do `raw` (raw_size bajtow).
+    static void decode_streams_block(const DecodeTable& table, const uint8_t* payload, size_t payload_size,
+                                     uint8_t padding, uint64_t raw_size, uint8_t* raw) {
+        // Kazdy symbol ma co najmniej 1 bit, wiec rozmiar bloku jest ograniczony danymi.
+        if (padding != 0 || raw_size > static_cast<uint64_t>(payload_size) * 8) {
+            throw std::runtime_error("Niepoprawny naglowek bloku");
+        }
+        const uint8_t* streams[HuffFormat::MAX_STREAMS];
+        size_t sizes[HuffFormat::MAX_STREAMS];
+        unsigned count = HuffFormat::read_streams(payload, payload_size, streams, sizes);
+        table.decode_interleaved(streams, sizes, count, raw_size, raw);
+    }
+
+    // Koduje dane podanymi kodami do strumienia bitow i zwraca liczbe bitow dopelnienia.
+    static uint8_t write_bits(const uint8_t* data, size_t size, const CodeTable& codes, BitWriter& writer) {
+        for (size_t i = 0; i < size; ++i) {
+            const HuffmanCode& code = codes[data[i]];
+            if (code.length == 0) {
+                throw std::runtime_error("Brak kodu Huffmana dla bajtu");
+            }
+            writer.put(code.bits, code.length);
+        }
+        return writer.finish();
+    }
+
+    // Koduje dane na przemian do kilku strumieni bitow: bajt i trafia do
+    // strumienia i % writers.size(). Strumienie sa konczone (finish).
+    static void write_bits(const uint8_t* data, size_t size, const CodeTable& codes, std::vector<BitWriter>& writers) {
+        if (writers.size() == 1) {
+            write_bits(data, size, codes, writers[0]);
+            return;
+        }
+        const size_t count = writers.size();
+        for (size_t i = 0; i < size; ++i) {
+            const HuffmanCode& code = codes[data[i]];
+            if (code.length == 0) {
+                throw std::runtime_error("Brak kodu Huffmana dla bajtu");
+            }
+            writers[i % count].put(code.bits, code.length);
+        }
+        for (BitWriter& writer : writers) writer.finish();
+    }
+
+    // Sprawdza ustawienia kodowania.
+    static void check_options(const CodecOptions& options) {
+        if (options.block_size == 0) throw std::runtime_error("Niepoprawny rozmiar bloku");
+        if (options.streams == 0 || options.streams > HuffFormat::MAX_STREAMS) {
+            throw std::runtime_error("Niepoprawna liczba strumieni");
+        }
+        if (options.max_code_length != 0 && (options.max_code_length < LengthLimitedCodes::MIN_LENGTH
+                                              || options.max_code_length > LengthLimitedCodes::MAX_LENGTH)) {
+            throw std::runtime_error("Niepoprawne ograniczenie dlugosci kodow");
+        }
+        if (options.order1 && options.streams > 1) {
+            throw std::runtime_error("Model rzedu 1 nie obsluguje przeplatanych strumieni");
+        }
+        if (options.order1 && options.block_size > UINT32_MAX) throw std::runtime_error("Niepoprawny rozmiar bloku");
+        if (options.min_gain > 99) throw std::runtime_error("Niepoprawny minimalny zysk kompresji");
+    }
+
+    // Flagi kontenera dla ustawien kodowania (bez indeksu).
+    static uint8_t container_flags(const CodecOptions& options) {
+        return static_cast<uint8_t>(HuffFormat::FLAG_STORED
+                                    | (options.checksum ? HuffFormat::FLAG_CHECKSUM : 0)
+                                    | (options.streams > 1 ? HuffFormat::FLAG_STREAMS : 0)
+                                    | (options.order1 ? HuffFormat::FLAG_ORDER1 : 0));
+    }
+
+    // Czy blok `size` bajtow, ktorego tablice kodow i dane zajma `coded_size` bajtow,
+    // jest mniejszy o co najmniej `min_gain` procent od bloku zapisanego bez kodowania.
+    static bool worth_coding(size_t size, double coded_size, const CodecOptions& options) {
+        return coded_size * 100.0 < static_cast<double>(size) * (100 - options.min_gain);
+    }
+
+private:
+    // Rozmiar tablic kodow i danych bloku (bez bajtu typu i sumy kontrolnej, wspolnych
+    // dla obu typow blokow).
+    static uint64_t coded_size(const ContextTables& tables, uint8_t flags, uint64_t payload_bits) {
+        const uint8_t common = HuffFormat::FLAG_STORED | HuffFormat::FLAG_CHECKSUM;
+        return HuffFormat::block_tables_size(tables, static_cast<uint8_t>(flags & ~common))
+            + (payload_bits + 7) / 8;
+    }
+
+    // Czyta sygnature i zwraca bajt wersji.
+    static int read_signature(const uint8_t*& p, const uint8_t* end) {
+        if (static_cast<size_t>(end - p) < sizeof(HuffFormat::MAGIC) + 1
+            || !std::equal(HuffFormat::MAGIC, HuffFormat::MAGIC + sizeof(HuffFormat::MAGIC), p,
+                           [](char a, uint8_t b) { return static_cast<uint8_t>(a) == b; })) {
+            throw std::runtime_error("Niepoprawny naglowek pliku");
+        }
+        p += sizeof(HuffFormat::MAGIC);
+        return *p++;
+    }
+
+    // Czyta sygnature, wersje (tylko format blokowy) i flagi. Zwraca flagi.
+    static uint8_t read_container_header(const uint8_t*& p, const uint8_t* end) {
+        if (read_signature(p, end) != HuffFormat::VERSION_BLOCKS) {
+            throw std::runtime_error("Nieobslugiwana wersja formatu pliku");
+        }
+        if (p == end) throw std::runtime_error("Niepoprawny naglowek pliku");
+        uint8_t flags = *p++;
+        if ((flags & ~HuffFormat::KNOWN_FLAGS) != 0) throw std::runtime_error("Nieobslugiwane flagi formatu pliku");
+        return flags;
+    }
+
+    static uint8_t read_padding(const uint8_t*& p, const uint8_t* end) {
+        if (p == end || *p > 7) throw std::runtime_error("Niepoprawny naglowek bloku");
+        return *p++;
+    }
+
+    static void skip_payload(const uint8_t*& p, const uint8_t* end, uint64_t payload_size) {
+        if (payload_size > static_cast<uint64_t>(end - p)) throw std::runtime_error("Niepoprawny koniec pliku");
+        p += payload_size;
+    }
+};
@@ -0,0 +1,452 @@
+#pragma once
+
+#include "huffman_code.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <vector>
+
+// Polozenie bloku kontenera: przesuniecie i rozmiar w pliku .huff oraz
+// przesuniecie i rozmiar w danych po dekompresji.
+struct BlockLocation {
+    std::uint64_t offset = 0;
+    std::uint64_t size = 0;
+    std::uint64_t raw_offset = 0;
+    std::uint64_t raw_size = 0;
+};
+
+// Tablice kodow bloku modelu rzedu 1: bajt jest kodowany kodami grupy, do ktorej
+// nalezy poprzedni bajt (kontekst). Bez modelu rzedu 1 blok ma jedna grupe.
+struct ContextTables {
+    static constexpr unsigned MAX_CLUSTERS = 16;
+
+    // Blok zapisany bez kodowania (dane bloku to bajty wejscia); nie ma wtedy tablic.
+    bool stored = false;
+    // Suma CRC-32C danych bloku po dekompresji (przy FLAG_CHECKSUM).
+    std::uint32_t checksum = 0;
+    unsigned count = 1;
+    // Grupa kazdego kontekstu (poprzedniego bajtu; przed pierwszym bajtem bloku - 0).
+    CodeLengths cluster_of{};
+    std::array<CodeLengths, MAX_CLUSTERS> lengths{};
+};
+
+// Elementy binarnego formatu .huff wspolne dla wszystkich wersji.
+class HuffFormat {
+public:
+    // Sygnatura plikow w formacie binarnym; stary format zaczyna sie drukowalnym znakiem ASCII.
+    static constexpr char MAGIC[4] = {'\x89', 'H', 'U', 'F'};
+    static constexpr int VERSION_LEGACY = 0;
+    static constexpr int VERSION_CANONICAL = 1;
+    static constexpr int VERSION_BLOCKS = 2;
+    // Adaptacyjny kod Huffmana: bez naglowka, za wersja od razu strumien bitow.
+    static constexpr int VERSION_ADAPTIVE = 3;
+    // Kody ze wspolnej tablicy (SharedTable): za wersja identyfikator tablicy,
+    // rozmiar danych, bajt paddingu i strumien bitow - bez dlugosci kodow i blokow.
+    static constexpr int VERSION_SHARED = 4;
+
+    // Flagi kontenera blokowego (bajt po wersji).
+    static constexpr std::uint8_t FLAG_INDEX = 0x01;
+    // Dane kazdego bloku sa podzielone na przemian miedzy kilka strumieni bitow.
+    static constexpr std::uint8_t FLAG_STREAMS = 0x02;
+    // Bloki sa kodowane modelem rzedu 1 (patrz write_block_tables).
+    static constexpr std::uint8_t FLAG_ORDER1 = 0x04;
+    // Za rozmiarem bloku jest bajt typu: BLOCK_CODED albo BLOCK_STORED (patrz write_block_tables).
+    static constexpr std::uint8_t FLAG_STORED = 0x08;
+    // Przed tablicami kazdego bloku jest suma CRC-32C jego danych (patrz write_block_tables).
+    static constexpr std::uint8_t FLAG_CHECKSUM = 0x10;
+    static constexpr std::uint8_t KNOWN_FLAGS = FLAG_INDEX | FLAG_STREAMS | FLAG_ORDER1 | FLAG_STORED | FLAG_CHECKSUM;
+
+    // Typy blokow przy FLAG_STORED: dane zakodowane albo skopiowane bez kodowania.
+    static constexpr std::uint8_t BLOCK_CODED = 0;
+    static constexpr std::uint8_t BLOCK_STORED = 1;
+
+    // Najwieksza liczba przeplatanych strumieni w bloku.
+    static constexpr unsigned MAX_STREAMS = 8;  // = DecodeTable::MAX_STREAMS
+
+    // Pierwszy blok kontenera zaczyna sie za sygnatura, wersja i flagami.
+    static constexpr std::uint64_t FIRST_BLOCK_OFFSET = sizeof(MAGIC) + 2;
+
+    // Stopka indeksu: 8 bajtow przesuniecia indeksu (little-endian) i sygnatura.
+    static constexpr char INDEX_MAGIC[4] = {'H', 'I', 'D', 'X'};
+    static constexpr std::uint64_t INDEX_FOOTER_SIZE = 8 + sizeof(INDEX_MAGIC);
+
+    // Dopisuje sygnature i bajt wersji.
+    static void write_signature(std::vector<std::uint8_t>& out, int version) {
+        out.insert(out.end(), MAGIC, MAGIC + sizeof(MAGIC));
+        out.push_back(static_cast<std::uint8_t>(version));
+    }
+
+    // Czyta sygnature i zwraca wersje formatu. Dla plikow bez sygnatury
+    // zwraca VERSION_LEGACY, zostawiajac strumien na poczatku. Stary format
+    // zaczyna sie od tekstu, wiec wystarczy podejrzec pierwszy bajt - wejscie
+    // moze byc potokiem, ktorego nie da sie cofnac.
+    static int read_version(std::istream& in) {
+        if (in.peek() != static_cast<unsigned char>(MAGIC[0])) {
+            in.clear();
+            return VERSION_LEGACY;
+        }
+        char magic[sizeof(MAGIC)] = {};
+        in.read(magic, sizeof(magic));
+        if (in.gcount() == sizeof(magic) && std::equal(magic, magic + sizeof(magic), MAGIC)) {
+            int version = in.get();
+            if (version < VERSION_CANONICAL || version > VERSION_SHARED) {
+                throw std::runtime_error("Nieobslugiwana wersja formatu pliku");
+            }
+            return version;
+        }
+        in.clear();
+        in.seekg(0);
+        return VERSION_LEGACY;
+    }
+
+    // Najwiekszy rozmiar liczby zapisanej przez write_varint.
+    static constexpr std::size_t MAX_VARINT_SIZE = 10;
+    // Najwiekszy rozmiar dlugosci kodow zapisanych przez write_code_lengths (jeden bajt na symbol).
+    static constexpr std::size_t MAX_CODE_LENGTHS_SIZE = 256;
+
+    // Dopisuje liczbe w kodowaniu LEB128 (7 bitow na bajt, najstarszy bit - kontynuacja).
+    static void write_varint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+        emit_varint([&](std::uint8_t byte) { out.push_back(byte); }, value);
+    }
+
+    // Zapisuje liczbe jak wyzej do pamieci [p, end) i przesuwa `p` za nia.
+    static void write_varint(std::uint8_t*& p, const std::uint8_t* end, std::uint64_t value) {
+        emit_varint([&](std::uint8_t byte) { put_byte(p, end, byte); }, value);
+    }
+
+    // Liczba bajtow, jaka zajmie `value` zapisana przez write_varint.
+    static std::size_t varint_size(std::uint64_t value) {
+        std::size_t size = 1;
+        for (; value >= 0x80; value >>= 7) size++;
+        return size;
+    }
+
+    // Zapisuje bajt do pamieci [p, end) i przesuwa `p`.
+    static void put_byte(std::uint8_t*& p, const std::uint8_t* end, std::uint8_t byte) {
+        if (p == end) throw std::runtime_error("Za maly bufor wyjsciowy");
+        *p++ = byte;
+    }
+
+    // Zapisuje 32-bitowa liczbe (little-endian) do pamieci [p, end) i przesuwa `p` za nia.
+    static void write_u32(std::uint8_t*& p, const std::uint8_t* end, std::uint32_t value) {
+        for (unsigned i = 0; i < 4; ++i) put_byte(p, end, static_cast<std::uint8_t>(value >> (8 * i)));
+    }
+
+    // Czyta liczbe zapisana przez write_u32 z pamieci [p, end) i przesuwa `p` za nia.
+    static std::uint32_t read_u32(const std::uint8_t*& p, const std::uint8_t* end) {
+        if (end - p < 4) throw std::runtime_error("Niepoprawny naglowek pliku");
+        std::uint32_t value = 0;
+        for (unsigned i = 0; i < 4; ++i) value |= static_cast<std::uint32_t>(*p++) << (8 * i);
+        return value;
+    }
+
+    // Czyta liczbe zapisana przez write_varint.
+    static std::uint64_t read_varint(std::istream& in) {
+        return parse_varint([&]() { return in.get(); });
+    }
+
+    // Czyta liczbe zapisana przez write_varint z pamieci [p, end) i przesuwa `p` za nia.
+    static std::uint64_t read_varint(const std::uint8_t*& p, const std::uint8_t* end) {
+        return parse_varint([&]() { return p == end ? -1 : *p++; });
+    }
+
+    // Zapisuje do pamieci [p, end) tablice strumieni bloku (liczba strumieni i rozmiary
+    // wszystkich poza ostatnim) oraz same strumienie, jeden za drugim.
+    static void write_streams(std::uint8_t*& p, const std::uint8_t* end,
+                              const std::uint8_t* const* streams, const std::size_t* sizes, unsigned count) {
+        if (streams_size(sizes, count) > static_cast<std::size_t>(end - p)) {
+            throw std::runtime_error("Za maly bufor wyjsciowy");
+        }
+        *p++ = static_cast<std::uint8_t>(count);
+        for (unsigned k = 0; k + 1 < count; ++k) write_varint(p, end, sizes[k]);
+        for (unsigned k = 0; k < count; ++k) {
+            std::copy(streams[k], streams[k] + sizes[k], p);
+            p += sizes[k];
+        }
+    }
+
+    // Rozmiar danych bloku zapisanych przez write_streams.
+    static std::size_t streams_size(const std::size_t* sizes, unsigned count) {
+        std::size_t size = 1;
+        for (unsigned k = 0; k < count; ++k) {
+            if (k + 1 < count) size += varint_size(sizes[k]);
+            size += sizes[k];
+        }
+        return size;
+    }
+
+    // Dzieli dane bloku zapisane przez write_streams na strumienie. Zwraca ich liczbe.
+    static unsigned read_streams(const std::uint8_t* payload, std::size_t size,
+                                 const std::uint8_t* streams[MAX_STREAMS], std::size_t sizes[MAX_STREAMS]) {
+        const std::uint8_t* end = payload + size;
+        if (size == 0 || payload[0] == 0 || payload[0] > MAX_STREAMS) {
+            throw std::runtime_error("Niepoprawna tablica strumieni");
+        }
+        unsigned count = payload[0];
+        const std::uint8_t* p = payload + 1;
+        std::uint64_t total = 0;
+        for (unsigned k = 0; k + 1 < count; ++k) {
+            std::uint64_t value = read_varint(p, end);
+            if (value > static_cast<std::uint64_t>(end - p)) throw std::runtime_error("Niepoprawna tablica strumieni");
+            sizes[k] = static_cast<std::size_t>(value);
+            total += value;
+        }
+        if (total > static_cast<std::uint64_t>(end - p)) throw std::runtime_error("Niepoprawna tablica strumieni");
+        sizes[count - 1] = static_cast<std::size_t>(end - p - total);
+        for (unsigned k = 0; k < count; ++k) {
+            streams[k] = p;
+            p += sizes[k];
+        }
+        return count;
+    }
+
+    // Dopisuje dlugosci kodow kanonicznych zakodowane seriami: bajt 0x00-0x3F
+    // to dlugosc jednego symbolu, 0x40-0x7F powtarza poprzednia dlugosc
+    // (b & 0x3F) + 1 razy, a 0x80-0xFF oznacza (b & 0x7F) + 1 nieuzywanych symboli.
+    static void write_code_lengths(std::vector<std::uint8_t>& out, const CodeLengths& lengths) {
+        emit_code_lengths([&](std::uint8_t byte) { out.push_back(byte); }, lengths);
+    }
+
+    // Zapisuje dlugosci kodow jak wyzej do pamieci [p, end) i przesuwa `p` za nie.
+    static void write_code_lengths(std::uint8_t*& p, const std::uint8_t* end, const CodeLengths& lengths) {
+        emit_code_lengths([&](std::uint8_t byte) { put_byte(p, end, byte); }, lengths);
+    }
+
+    // Czyta dlugosci kodow zapisane przez write_code_lengths.
+    static CodeLengths read_code_lengths(std::istream& in) {
+        return parse_code_lengths([&]() { return in.get(); });
+    }
+
+    // Czyta dlugosci kodow z pamieci [p, end) i przesuwa `p` za nie.
+    static CodeLengths read_code_lengths(const std::uint8_t*& p, const std::uint8_t* end) {
+        return parse_code_lengths([&]() { return p == end ? -1 : *p++; });
+    }
+
+    // Rozmiar sumy kontrolnej bloku (FLAG_CHECKSUM).
+    static constexpr std::size_t CHECKSUM_SIZE = 4;
+    // Najwiekszy rozmiar tablic kodow bloku (z suma kontrolna, bajtem typu i modelem rzedu 1).
+    static constexpr std::size_t MAX_BLOCK_TABLES_SIZE =
+        CHECKSUM_SIZE + 2 + (ContextTables::MAX_CLUSTERS + 1) * MAX_CODE_LENGTHS_SIZE;
+
+    // Zapisuje tablice kodow bloku do pamieci [p, end). Przy FLAG_CHECKSUM (`flags`)
+    // najpierw jest suma CRC-32C danych bloku (4 bajty, little-endian), przy FLAG_STORED
+    // bajt typu bloku; blok zapisany bez kodowania nie ma tablic.
+    // Z modelem rzedu 1 (FLAG_ORDER1) dalej jest bajt z liczba grup, przy wiecej niz
+    // jednej grupie mapa kontekstow (numery grup zakodowane jak dlugosci kodow),
+    // a potem dlugosci kodow kazdej grupy. Bez FLAG_ORDER1 zapisywane sa tylko
+    // dlugosci kodow jedynej grupy.
+    static void write_block_tables(std::uint8_t*& p, const std::uint8_t* end, const ContextTables& tables,
+                                   std::uint8_t flags) {
+        emit_block_tables([&](std::uint8_t byte) { put_byte(p, end, byte); }, tables, flags);
+    }
+
+    // Rozmiar tablic kodow bloku zapisanych przez write_block_tables.
+    static std::size_t block_tables_size(const ContextTables& tables, std::uint8_t flags) {
+        std::size_t size = 0;
+        emit_block_tables([&](std::uint8_t) { size++; }, tables, flags);
+        return size;
+    }
+
+    // Czyta tablice kodow bloku zapisane przez write_block_tables.
+    static ContextTables read_block_tables(std::istream& in, std::uint8_t flags) {
+        return parse_block_tables([&]() { return in.get(); }, flags);
+    }
+
+    // Czyta tablice kodow bloku z pamieci [p, end) i przesuwa `p` za nie.
+    static ContextTables read_block_tables(const std::uint8_t*& p, const std::uint8_t* end, std::uint8_t flags) {
+        return parse_block_tables([&]() { return p == end ? -1 : *p++; }, flags);
+    }
+
+    // Dopisuje indeks blokow (liczba blokow, potem rozmiar skompresowany i rozmiar
+    // danych kazdego bloku) oraz stopke wskazujaca poczatek indeksu.
+    static void write_index(std::vector<std::uint8_t>& out, const std::vector<BlockLocation>& blocks,
+                            std::uint64_t index_offset) {
+        write_varint(out, blocks.size());
+        for (const BlockLocation& block : blocks) {
+            write_varint(out, block.size);
+            write_varint(out, block.raw_size);
+        }
+        for (unsigned i = 0; i < 8; ++i) {
+            out.push_back(static_cast<std::uint8_t>(index_offset >> (8 * i)));
+        }
+        out.insert(out.end(), INDEX_MAGIC, INDEX_MAGIC + sizeof(INDEX_MAGIC));
+    }
+
+    // Czyta indeks blokow ze stopki pliku i odtwarza polozenie kazdego bloku.
+    static std::vector<BlockLocation> read_index(std::istream& in) {
+        in.clear();
+        in.seekg(0, std::ios::end);
+        std::uint64_t file_size = static_cast<std::uint64_t>(in.tellg());
+        if (file_size < FIRST_BLOCK_OFFSET + INDEX_FOOTER_SIZE) {
+            throw std::runtime_error("Niepoprawny indeks blokow");
+        }
+
+        unsigned char footer[INDEX_FOOTER_SIZE];
+        in.seekg(static_cast<std::streamoff>(file_size - INDEX_FOOTER_SIZE));
+        in.read(reinterpret_cast<char*>(footer), sizeof(footer));
+        if (in.gcount() != sizeof(footer) || !std::equal(footer + 8, footer + sizeof(footer), INDEX_MAGIC,
+                                                          [](unsigned char a, char b) { return a == static_cast<unsigned char>(b); })) {
+            throw std::runtime_error("Niepoprawny indeks blokow");
+        }
+        std::uint64_t index_offset = 0;
+        for (unsigned i = 0; i < 8; ++i) {
+            index_offset |= static_cast<std::uint64_t>(footer[i]) << (8 * i);
+        }
+        if (index_offset >= file_size - INDEX_FOOTER_SIZE) {
+            throw std::runtime_error("Niepoprawny indeks blokow");
+        }
+
+        in.seekg(static_cast<std::streamoff>(index_offset));
+        std::uint64_t count = read_varint(in);
+        if (count > index_offset) {
+            throw std::runtime_error("Niepoprawny indeks blokow");
+        }
+        std::vector<BlockLocation> blocks(static_cast<std::size_t>(count));
+        std::uint64_t offset = FIRST_BLOCK_OFFSET;
+        std::uint64_t raw_offset = 0;
+        for (BlockLocation& block : blocks) {
+            block.offset = offset;
+            block.size = read_varint(in);
+            block.raw_offset = raw_offset;
+            block.raw_size = read_varint(in);
+            offset += block.size;
+            raw_offset += block.raw_size;
+        }
+        // Za ostatnim blokiem jest jednobajtowy znacznik konca.
+        if (offset + 1 != index_offset) {
+            throw std::runtime_error("Niepoprawny indeks blokow");
+        }
+        return blocks;
+    }
+
+private:
+    // Wspolne zapisy dla wektora i pamieci; `put` dopisuje jeden bajt.
+    template <typename Put>
+    static void emit_varint(Put put, std::uint64_t value) {
+        while (value >= 0x80) {
+            put(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        put(static_cast<std::uint8_t>(value));
+    }
+
+    template <typename Put>
+    static void emit_block_tables(Put put, const ContextTables& tables, std::uint8_t flags) {
+        if (flags & FLAG_CHECKSUM) {
+            for (unsigned shift = 0; shift < 32; shift += 8) put(static_cast<std::uint8_t>(tables.checksum >> shift));
+        }
+        if (flags & FLAG_STORED) {
+            put(tables.stored ? BLOCK_STORED : BLOCK_CODED);
+            if (tables.stored) return;
+        } else if (tables.stored) {
+            throw std::runtime_error("Blok bez kodowania wymaga flagi FLAG_STORED");
+        }
+        if (flags & FLAG_ORDER1) {
+            put(static_cast<std::uint8_t>(tables.count));
+            if (tables.count > 1) emit_code_lengths(put, tables.cluster_of);
+        }
+        for (unsigned c = 0; c < tables.count; ++c) emit_code_lengths(put, tables.lengths[c]);
+    }
+
+    template <typename Put>
+    static void emit_code_lengths(Put put, const CodeLengths& lengths) {
+        std::size_t i = 0;
+        while (i < lengths.size()) {
+            std::size_t run = 1;
+            while (i + run < lengths.size() && lengths[i + run] == lengths[i]) run++;
+
+            if (lengths[i] == 0) {
+                run = std::min<std::size_t>(run, 128);
+                put(static_cast<std::uint8_t>(0x80 | (run - 1)));
+            } else {
+                put(lengths[i]);
+                run = std::min<std::size_t>(run, 65);
+                if (run > 1) put(static_cast<std::uint8_t>(0x40 | (run - 2)));
+            }
+            i += run;
+        }
+    }
+
+    // Wspolne parsery dla strumienia i pamieci; `next` zwraca kolejny bajt albo -1 na koncu danych.
+    template <typename Next>
+    static std::uint64_t parse_varint(Next next) {
+        std::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            int byte = next();
+            if (byte < 0) {
+                throw std::runtime_error("Niepoprawny naglowek pliku");
+            }
+            value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        throw std::runtime_error("Niepoprawny naglowek pliku");
+    }
+
+    template <typename Next>
+    static ContextTables parse_block_tables(Next next, std::uint8_t flags) {
+        ContextTables tables;
+        if (flags & FLAG_CHECKSUM) {
+            for (unsigned shift = 0; shift < 32; shift += 8) {
+                int byte = next();
+                if (byte < 0) throw std::runtime_error("Niepoprawny naglowek bloku");
+                tables.checksum |= static_cast<std::uint32_t>(byte) << shift;
+            }
+        }
+        if (flags & FLAG_STORED) {
+            int type = next();
+            if (type == BLOCK_STORED) {
+                tables.stored = true;
+                tables.count = 0;
+                return tables;
+            }
+            if (type != BLOCK_CODED) throw std::runtime_error("Niepoprawny naglowek bloku");
+        }
+        if (flags & FLAG_ORDER1) {
+            int count = next();
+            if (count < 1 || count > static_cast<int>(ContextTables::MAX_CLUSTERS)) {
+                throw std::runtime_error("Niepoprawny naglowek bloku");
+            }
+            tables.count = static_cast<unsigned>(count);
+            if (tables.count > 1) {
+                tables.cluster_of = parse_code_lengths(next);
+                for (std::uint8_t cluster : tables.cluster_of) {
+                    if (cluster >= tables.count) throw std::runtime_error("Niepoprawny naglowek bloku");
+                }
+            }
+        }
+        for (unsigned c = 0; c < tables.count; ++c) tables.lengths[c] = parse_code_lengths(next);
+        return tables;
+    }
+
+    template <typename Next>
+    static CodeLengths parse_code_lengths(Next next) {
+        CodeLengths lengths{};
+        std::size_t i = 0;
+        std::uint8_t previous = 0;
+        while (i < lengths.size()) {
+            int token = next();
+            if (token < 0) {
+                throw std::runtime_error("Niepoprawny naglowek pliku");
+            }
+            std::size_t run = 1;
+            std::uint8_t length = static_cast<std::uint8_t>(token);
+            if (token & 0x80) {
+                run = static_cast<std::size_t>(token & 0x7F) + 1;
+                length = 0;
+            } else if (token & 0x40) {
+                run = static_cast<std::size_t>(token & 0x3F) + 1;
+                length = previous;
+            }
+            if (i + run > lengths.size()) {
+                throw std::runtime_error("Niepoprawny naglowek pliku");
+            }
+            for (std::size_t k = 0; k < run; ++k) lengths[i++] = length;
+            previous = length;
+        }
+        return lengths;
+    }
+};
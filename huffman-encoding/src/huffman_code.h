@@ -0,0 +1,19 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+// Kod Huffmana jako liczba: pierwszy bit kodu jest najstarszym z `length` bitow.
+struct HuffmanCode {
+    std::uint64_t bits = 0;
+    std::uint8_t length = 0;
+};
+
+// Plaska tablica kodow indeksowana wartoscia bajtu (length == 0 - brak kodu).
+using CodeTable = std::array<HuffmanCode, 256>;
+
+// Dlugosci kodow kanonicznych indeksowane wartoscia bajtu (0 - symbol nie wystepuje).
+using CodeLengths = std::array<std::uint8_t, 256>;
+
+// Histogram bajtow: liczba wystapien indeksowana wartoscia bajtu.
+using ByteHistogram = std::array<std::uint64_t, 256>;
@@ -1,119 +1,116 @@
 #pragma once
 
-#include "priority_queue.h"
+#include "huffman_code.h"
+#include "decode_table.h"
 
-#include <memory>
+#include <array>
 #include <cstddef>
 #include <vector>
 #include <cstdint>
-#include <unordered_map>
-#include <string>
-#include <map>
-#include <type_traits>
 #include <stdexcept>
 #include <ostream>
-#include <istream>
 #include <algorithm>
 
+// Drzewo Huffmana w stalej tablicy wezlow (indeksy zamiast wskaznikow).
+// Budowa nie alokuje pamieci: liscie leza w wezlach 0..n-1, a wezly
+// wewnetrzne sa dopisywane za nimi w kolejnosci laczenia.
 class HuffmanTree {
 private:
-    // Węzeł
+    static constexpr std::size_t MAX_NODES = 2 * 256 - 1;
+    static constexpr std::int16_t NONE = -1;
+
+    // Węzeł; lisc nie ma dzieci (left == NONE)
     struct Node {
-        std::unique_ptr<Node> left_child;
-        std::unique_ptr<Node> right_child;
-        std::uint32_t frequency = 0;
-        std::vector<std::byte> headers;
+        std::uint64_t frequency = 0;
+        std::int16_t left = NONE;
+        std::int16_t right = NONE;
+        std::uint8_t symbol = 0;
     };
 
-    std::unique_ptr<Node> root;
+    std::array<Node, MAX_NODES> nodes;
+    std::size_t node_count = 0;
+    std::int16_t root = NONE;
 
 public:
-    // Konstruktor standardowy
-    HuffmanTree(std::byte header, std::uint32_t frequency) {
-        root = std::make_unique<Node>();
-        root->frequency = frequency;
-        root->headers.push_back(header);
+    // Buduje plaska tablice 256 kodow Huffmana (bity jako liczba i dlugosc) dla lisci.
+    CodeTable build_huffman_codes() const {
+        CodeTable table{};
+        if (root == NONE) return table;
+
+        if (is_leaf(nodes[root])) {
+            table[nodes[root].symbol] = HuffmanCode{0, 1};
+            return table;
+        }
+        build_code_entries(root, 0, 0, table);
+        return table;
     }
 
-    // Budowa drzewa z dwóch poddrzew
-    static std::unique_ptr<HuffmanTree> rebuild(std::unique_ptr<HuffmanTree> tree_left,std::unique_ptr<HuffmanTree> tree_right) {
-        std::unique_ptr<Node> left_node_ptr = tree_left->take_root();
-        std::unique_ptr<Node> right_node_ptr = tree_right->take_root();
-
-        tree_left.reset();
-        tree_right.reset();
-
-        const Node& left_node_ref = *left_node_ptr;
-        const Node& right_node_ref = *right_node_ptr;
-
-        std::vector<std::byte> new_headers = build_headers(left_node_ref.headers, right_node_ref.headers);
-
-        std::unique_ptr<Node> new_node = std::make_unique<Node>();
-        Node& new_node_reference = *new_node;
-        new_node_reference.left_child = std::move(left_node_ptr);
-        new_node_reference.right_child = std::move(right_node_ptr);
-        new_node_reference.frequency = left_node_ref.frequency + right_node_ref.frequency;
-        new_node_reference.headers = std::move(new_headers);
+    // Budowa drzewa z histogramu bajtow (pomijane sa bajty, ktore nie wystepuja)
+    // metoda dwoch kolejek: posortowane liscie i wezly wewnetrzne, ktore powstaja
+    // w niemalejacej kolejnosci wag, wiec mniejszy z poczatkow obu kolejek jest minimum.
+    //
+    // Z `legacy_order` drzewo jest budowane dokladnie tak jak w starym formacie:
+    // laczone sa wezly o najmniejszej parze (waga, najmniejszy bajt poddrzewa),
+    // ale jako pierwszy zdejmowany jest najmniejszy obecny bajt (dawna kolejka nie
+    // naprawiala korzenia kopca). Dekodowanie plikow v0 musi odtworzyc to samo drzewo.
+    static HuffmanTree from_frequencies(const ByteHistogram& frequencies, bool legacy_order = false) {
+        HuffmanTree tree;
+        for (unsigned int symbol = 0; symbol < frequencies.size(); symbol++) {
+            if (frequencies[symbol] == 0) continue;
+            Node& leaf = tree.nodes[tree.node_count++];
+            leaf.frequency = frequencies[symbol];
+            leaf.symbol = static_cast<std::uint8_t>(symbol);
+        }
+        if (tree.node_count == 0) throw std::runtime_error("Pusty histogram");
 
-        return std::unique_ptr<HuffmanTree>(new HuffmanTree(std::move(new_node)));
+        if (legacy_order) {
+            tree.build_legacy();
+        } else {
+            tree.build_two_queues();
+        }
+        return tree;
     }
 
-    // Buduje mapy kodow Huffmana dla lisci.
-    std::unordered_map<std::byte, std::string> build_huffman_codes() const {
-        std::unordered_map<std::byte, std::string> codes;
-        if (!root) return codes;
-
-        std::string code;
-        build_codes(*root, code, codes);
+    // Dekoduje dane tablica podgladajaca `table_bits` bitow naraz.
+    void decode_payload_to_stream(const std::vector<uint8_t>& payload, uint8_t padding, std::ostream& out,
+                                  unsigned table_bits = DecodeTable::DEFAULT_BITS) const {
+        if (root == NONE) return;
+        if (padding > 7) throw std::runtime_error("Niepoprawny padding");
+        if (payload.empty()) return;
 
-        if (is_leaf(*root) && !root->headers.empty() && codes[root->headers[0]].empty()) {
-            codes[root->headers[0]] = "0";
-        }
-        return codes;
+        DecodeTable table(build_huffman_codes(), table_bits);
+        std::uint64_t bit_count = static_cast<std::uint64_t>(payload.size()) * 8 - padding;
+        MemoryPayloadSource source(payload.data(), payload.size(), bit_count);
+        table.decode(source, out);
     }
 
-    // Budowa drzewa ze słownika częstotliwości
-    static std::unique_ptr<HuffmanTree> from_frequencies(const std::map<std::byte, uint32_t>& frequencies) {
-        std::vector<MinPriorityQueue<HuffmanTree>::Item> items;
-        items.reserve(frequencies.size());
-        for (auto iterator = frequencies.begin(); iterator != frequencies.end(); iterator++) {
-            std::byte b = iterator->first;
-            uint32_t f = iterator->second;
-            unsigned int tie = std::to_integer<unsigned int>(b);
-            items.push_back(MinPriorityQueue<HuffmanTree>::Item{f, tie, std::make_unique<HuffmanTree>(b, f)});
+    // Dekoduje `symbol_count` symboli zapisanych na przemian w kilku strumieniach
+    // (symbol i w strumieniu i % streams.size()), wszystkie strumienie w jednej petli.
+    void decode_payload_to_stream(const std::vector<std::vector<uint8_t>>& streams, std::uint64_t symbol_count,
+                                  std::ostream& out, unsigned table_bits = DecodeTable::DEFAULT_BITS) const {
+        if (root == NONE) return;
+        if (streams.empty() || streams.size() > DecodeTable::MAX_STREAMS) {
+            throw std::runtime_error("Niepoprawna liczba strumieni");
         }
 
-        MinPriorityQueue<HuffmanTree> pq = MinPriorityQueue<HuffmanTree>::linear_build(std::move(items));
-
-        while (pq.size() > 1) {
-            auto p1 = pq.pop();
-            auto p2 = pq.pop();
-
-            unsigned int f1 = p1.first.first;
-            unsigned int t1 = p1.first.second;
-            std::unique_ptr<HuffmanTree> tree1 = std::move(p1.second);
-
-            unsigned int f2 = p2.first.first;
-            unsigned int t2 = p2.first.second;
-            std::unique_ptr<HuffmanTree> tree2 = std::move(p2.second);
-
-            std::unique_ptr<HuffmanTree> new_tree = HuffmanTree::rebuild(std::move(tree1), std::move(tree2));
-            unsigned int new_freq = f1 + f2;
-            unsigned int new_tie  = (t1 < t2) ? t1 : t2;
-
-            pq.push(MinPriorityQueue<HuffmanTree>::Item{new_freq, new_tie, std::move(new_tree)});
+        const std::uint8_t* data[DecodeTable::MAX_STREAMS];
+        std::size_t sizes[DecodeTable::MAX_STREAMS];
+        for (std::size_t k = 0; k < streams.size(); ++k) {
+            data[k] = streams[k].data();
+            sizes[k] = streams[k].size();
         }
-
-        auto last = pq.pop();
-        return std::move(last.second);
+        std::vector<std::uint8_t> raw(static_cast<std::size_t>(symbol_count));
+        DecodeTable(build_huffman_codes(), table_bits)
+            .decode_interleaved(data, sizes, static_cast<unsigned>(streams.size()), symbol_count, raw.data());
+        out.write(reinterpret_cast<const char*>(raw.data()), static_cast<std::streamsize>(raw.size()));
     }
 
-    // dekoduje
-    void decode_payload_to_stream(const std::vector<uint8_t>& payload,uint8_t padding, std::ostream& out) const {
-        if (!root) return;
+    // Referencyjny dekoder bit po bicie (do porownan w huff_bench).
+    void decode_payload_bitwise(const std::vector<uint8_t>& payload,uint8_t padding, std::ostream& out) const {
+        if (root == NONE) return;
         if (padding > 7) throw std::runtime_error("Niepoprawny padding");
 
-        const Node* node = root.get();
+        std::int16_t node = root;
 
         for (size_t i = 0; i < payload.size(); ++i) {
             uint8_t byte = payload[i];
@@ -124,56 +121,106 @@ public:
 
             for (int b = 7; b >= 8 - bits; --b) {
                 bool bit = ((byte >> b) & 1) != 0;
-                node = bit ? node->right_child.get() : node->left_child.get();
+                // Drzewo z jednym lisciem ma kod "0" i nie ma dzieci.
+                if (!is_leaf(nodes[node])) node = bit ? nodes[node].right : nodes[node].left;
 
-                if (is_leaf(*node)) {
-                    out.put(static_cast<char>(std::to_integer<unsigned char>(node->headers[0])));
-                    node = root.get();
+                if (is_leaf(nodes[node])) {
+                    out.put(static_cast<char>(nodes[node].symbol));
+                    node = root;
                 }
             }
         }
     }
 
 private:
-    // Rekurencyjna budowa kodów jako stringi
-    static void build_codes(const Node& node, std::string& code, std::unordered_map<std::byte, std::string>& codes) {
+    HuffmanTree() = default;
+
+    // Rekurencyjna budowa kodow
+    void build_code_entries(std::int16_t index, std::uint64_t code, std::uint8_t length, CodeTable& table) const {
+        const Node& node = nodes[index];
         if (is_leaf(node)) {
-            if (!node.headers.empty()) codes[node.headers[0]] = code;
+            table[node.symbol] = HuffmanCode{code, length};
             return;
         }
-        if (node.left_child) {
-            code.push_back('0');
-            build_codes(*node.left_child, code, codes);
-            code.pop_back();
-        }
-        if (node.right_child) {
-            code.push_back('1');
-            build_codes(*node.right_child, code, codes);
-            code.pop_back();
-        }
+        if (length >= 64) throw std::runtime_error("Zbyt dlugi kod Huffmana");
+        build_code_entries(node.left, code << 1, static_cast<std::uint8_t>(length + 1), table);
+        build_code_entries(node.right, (code << 1) | 1, static_cast<std::uint8_t>(length + 1), table);
     }
 
-    // Konstruktor prywatny drzewa z węzła
-    explicit HuffmanTree(std::unique_ptr<Node> root_node) {
-        root = std::move(root_node);
+    // Dopisuje wezel wewnetrzny o dzieciach `left` i `right`.
+    std::int16_t join(std::int16_t left, std::int16_t right) {
+        Node& node = nodes[node_count];
+        node.frequency = nodes[left].frequency + nodes[right].frequency;
+        node.left = left;
+        node.right = right;
+        return static_cast<std::int16_t>(node_count++);
     }
 
-    // Budowa nowych nagłówków w trakcie łączenia węzłów
-    static std::vector<std::byte> build_headers(const std::vector<std::byte>& headers_left, const std::vector<std::byte>& headers_right){
-        std::vector<std::byte> new_headers;
-        new_headers.reserve(headers_left.size() + headers_right.size());
-        new_headers.insert(new_headers.end(), headers_left.begin(), headers_left.end());
-        new_headers.insert(new_headers.end(), headers_right.begin(), headers_right.end());
-        return new_headers;
+    // Metoda dwoch kolejek na lisciach posortowanych po (waga, bajt).
+    void build_two_queues() {
+        const std::size_t leaves = node_count;
+        std::sort(nodes.begin(), nodes.begin() + static_cast<std::ptrdiff_t>(leaves),
+                  [](const Node& a, const Node& b) {
+                      return a.frequency != b.frequency ? a.frequency < b.frequency : a.symbol < b.symbol;
+                  });
+
+        std::size_t next_leaf = 0;
+        std::size_t next_internal = leaves;
+        auto take = [&]() {
+            bool use_leaf = next_leaf < leaves
+                && (next_internal == node_count || nodes[next_leaf].frequency <= nodes[next_internal].frequency);
+            return static_cast<std::int16_t>(use_leaf ? next_leaf++ : next_internal++);
+        };
+
+        for (std::size_t merges = 1; merges < leaves; ++merges) {
+            std::int16_t left = take();
+            std::int16_t right = take();
+            join(left, right);
+        }
+        root = static_cast<std::int16_t>(node_count - 1);
     }
 
-    // Test czy węzeł jest liściem
-    static bool is_leaf(const Node& n) {
-        return !n.left_child && !n.right_child;
+    // Odtwarza kolejnosc laczenia starego formatu (patrz from_frequencies).
+    void build_legacy() {
+        std::array<std::int16_t, 256> active{};
+        std::array<std::uint8_t, MAX_NODES> tie{};
+        std::size_t active_count = 0;
+        // Liscie leza w kolejnosci bajtow, wiec wezel 0 to najmniejszy obecny bajt.
+        for (std::size_t i = 1; i < node_count; ++i) {
+            active[active_count++] = static_cast<std::int16_t>(i);
+            tie[i] = nodes[i].symbol;
+        }
+        tie[0] = nodes[0].symbol;
+
+        auto pop_min = [&]() {
+            std::size_t best = 0;
+            for (std::size_t i = 1; i < active_count; ++i) {
+                const Node& a = nodes[active[i]];
+                const Node& b = nodes[active[best]];
+                if (a.frequency < b.frequency || (a.frequency == b.frequency && tie[active[i]] < tie[active[best]])) {
+                    best = i;
+                }
+            }
+            std::int16_t result = active[best];
+            active[best] = active[--active_count];
+            return result;
+        };
+
+        std::int16_t first = 0;
+        bool first_pending = true;
+        while (active_count + (first_pending ? 1 : 0) > 1) {
+            std::int16_t left = first_pending ? first : pop_min();
+            first_pending = false;
+            std::int16_t right = pop_min();
+            std::int16_t joined = join(left, right);
+            tie[joined] = std::min(tie[left], tie[right]);
+            active[active_count++] = joined;
+        }
+        root = first_pending ? first : active[0];
     }
 
-    // Oddaje orginalny wskaźnik na korzeń drzewa
-    std::unique_ptr<Node> take_root() {
-        return std::move(root);
+    // Test czy węzeł jest liściem
+    static bool is_leaf(const Node& n) {
+        return n.left == NONE;
     }
 };
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "huffman_code.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+// Dlugosci kodow o ograniczonej dlugosci, optymalne przy tym ograniczeniu
+// (algorytm package-merge). Przy limicie `max_length` buduje sie `max_length`
+// list: najglebsza zawiera same liscie, a kazda wyzsza - liscie scalone z parami
+// ("paczkami") elementow listy nizej. Z najwyzszej listy bierze sie 2n-2
+// najlzejszych elementow; kazde wystapienie liscia wydluza jego kod o 1 bit.
+class LengthLimitedCodes {
+public:
+    // 256 roznych bajtow wymaga kodow co najmniej 8-bitowych.
+    static constexpr unsigned MIN_LENGTH = 8;
+    static constexpr unsigned MAX_LENGTH = 63;
+
+    // Listy package-merge do ponownego uzycia: po pierwszym wywolaniu build z tymi
+    // samymi buforami i podobnym histogramem nie alokuje.
+    struct Buffers {
+        std::vector<std::uint64_t> previous;
+        std::vector<std::uint64_t> merged;
+        // Flagi lisci wszystkich poziomow; poziom `level` zaczyna sie od level * 2n.
+        std::vector<std::uint8_t> leaf_flags;
+    };
+
+    // Wyznacza dlugosci kodow dla histogramu przy kodach nie dluzszych niz `max_length`.
+    static CodeLengths build(const ByteHistogram& histogram, unsigned max_length) {
+        Buffers buffers;
+        return build(histogram, max_length, buffers);
+    }
+
+    // Jak wyzej, z listami w `buffers`.
+    static CodeLengths build(const ByteHistogram& histogram, unsigned max_length, Buffers& buffers) {
+        std::array<unsigned, 256> symbols;
+        std::size_t n = 0;
+        for (unsigned s = 0; s < histogram.size(); ++s) {
+            if (histogram[s] != 0) symbols[n++] = s;
+        }
+        if (n == 0) throw std::runtime_error("Pusty histogram");
+        if (max_length == 0 || max_length > MAX_LENGTH || (std::uint64_t{1} << max_length) < n) {
+            throw std::runtime_error("Niepoprawne ograniczenie dlugosci kodow");
+        }
+
+        CodeLengths lengths{};
+        if (n == 1) {
+            lengths[symbols[0]] = 1;
+            return lengths;
+        }
+
+        // Rowne wagi po bajcie - ta sama kolejnosc co sortowanie stabilne, ale bez bufora.
+        std::sort(symbols.begin(), symbols.begin() + static_cast<std::ptrdiff_t>(n), [&](unsigned a, unsigned b) {
+            return histogram[a] != histogram[b] ? histogram[a] < histogram[b] : a < b;
+        });
+
+        // Lista kazdego poziomu ma najwyzej n lisci i n - 1 paczek.
+        const std::size_t level_size = 2 * n;
+        std::vector<std::uint64_t>& previous = buffers.previous;
+        std::vector<std::uint64_t>& merged = buffers.merged;
+        buffers.leaf_flags.resize(max_length * level_size);
+        previous.clear();
+        for (unsigned level = max_length; level-- > 0;) {
+            std::uint8_t* flags = buffers.leaf_flags.data() + level * level_size;
+            merged.clear();
+
+            std::size_t leaf = 0;
+            std::size_t package = 0;
+            const std::size_t packages = previous.size() / 2;
+            while (leaf < n || package < packages) {
+                std::uint64_t package_weight = package < packages
+                    ? previous[2 * package] + previous[2 * package + 1]
+                    : UINT64_MAX;
+                if (leaf < n && histogram[symbols[leaf]] <= package_weight) {
+                    flags[merged.size()] = 1;
+                    merged.push_back(histogram[symbols[leaf++]]);
+                } else {
+                    flags[merged.size()] = 0;
+                    merged.push_back(package_weight);
+                    package++;
+                }
+            }
+            std::swap(previous, merged);
+        }
+
+        // Z poziomu 0 bierzemy 2n-2 elementow; wybrane paczki rozwijaja sie
+        // w dwa razy wiecej elementow poziomu nizej. Liscie na kazdej liscie
+        // sa posortowane, wiec wybrane sa zawsze najlzejsze symbole.
+        std::size_t take = 2 * n - 2;
+        for (unsigned level = 0; level < max_length && take > 0; ++level) {
+            const std::uint8_t* flags = buffers.leaf_flags.data() + level * level_size;
+            std::size_t leaves = 0;
+            for (std::size_t i = 0; i < take; ++i) leaves += flags[i];
+            for (std::size_t i = 0; i < leaves; ++i) lengths[symbols[i]]++;
+            take = 2 * (take - leaves);
+        }
+        return lengths;
+    }
+
+    // Rozmiar zakodowanych danych w bitach dla podanych dlugosci kodow.
+    static std::uint64_t encoded_bits(const ByteHistogram& histogram, const CodeLengths& lengths) {
+        std::uint64_t bits = 0;
+        for (std::size_t s = 0; s < histogram.size(); ++s) bits += histogram[s] * lengths[s];
+        return bits;
+    }
+
+    // Najdluzszy kod w tablicy dlugosci.
+    static unsigned longest(const CodeLengths& lengths) {
+        return *std::max_element(lengths.begin(), lengths.end());
+    }
+};
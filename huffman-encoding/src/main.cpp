@@ -1,16 +1,36 @@
 #include "arg_paraser.h"
 #include "file_handler.h"
-#include "huffman_tree.h"
-#include "priority_queue.h"
+#include "batch_processor.h"
+#include "run_stats.h"
 
 #include <windows.h>
 #include <cstdint>
-#include <map>
+#include <cstdio>
 #include <memory>
-#include <unordered_map>
+#include <optional>
 #include <string>
-#include <type_traits>
 #include <stdexcept>
+#include <vector>
+
+// Opcje kompresji z argumentow, wspolne dla jednego pliku i trybu wsadowego. Liczbe
+// watkow ustawia wywolujacy: w trybie wsadowym watki dzieli pula miedzy plikami.
+static CompressOptions options_from(const Arguments& args, const SharedTable* table, RunStats* stats) {
+    CompressOptions options;
+    options.with_index = args.with_index;
+    options.io_mode = args.io_mode;
+    options.max_code_length = args.max_code_length;
+    options.streams = args.streams;
+    options.adaptive = args.adaptive;
+    options.order1 = args.model_order == 1;
+    options.min_gain = args.min_gain;
+    options.checksum = args.checksum;
+    options.sample = args.sample;
+    options.pipeline = args.pipeline;
+    if (args.block_size != 0) options.block_size = args.block_size;
+    options.table = table;
+    options.stats = stats;
+    return options;
+}
 
 // Uruchamia kompresje lub dekompresje na podstawie argumentow.
 int main(int argc, char* argv[]) {
@@ -18,18 +38,74 @@ int main(int argc, char* argv[]) {
 
     Arguments args = ArgumentParaser::parse_args(argc, argv);
 
+    if (args.mode == MODE::TRAIN) {
+        // Histogram calej probki; kazdy plik jest zliczany osobno.
+        std::vector<std::string> samples;
+        if (args.batch) {
+            std::vector<BatchItem> items = args.list_path.empty()
+                ? BatchProcessor::from_directory(args.input_path, true, "")
+                : BatchProcessor::from_list(args.list_path, true, "");
+            for (const BatchItem& item : items) samples.push_back(item.input.string());
+        } else {
+            samples.push_back(args.input_path);
+        }
+        ByteHistogram sample{};
+        for (const std::string& path : samples) {
+            ByteHistogram counts = FileHandler::count_bytes(path, args.io_mode);
+            for (size_t s = 0; s < sample.size(); ++s) sample[s] += counts[s];
+        }
+        SharedTable table = SharedTable::train(sample, args.max_code_length != 0 ? args.max_code_length
+                                                                                : SharedTable::DEFAULT_MAX_LENGTH);
+        table.save(args.output_path);
+        std::fprintf(stderr, "Tablica %08x (najdluzszy kod: %u bitow) z %zu plikow probki zapisana do %s.\n", table.id(),
+                     table.longest(), samples.size(), args.output_path.c_str());
+        return 0;
+    }
+
+    // Wspolna tablica kodow (--table) jest wczytywana raz dla wszystkich plikow.
+    std::optional<SharedTable> table;
+    if (!args.table_path.empty()) table.emplace(SharedTable::load(args.table_path));
+
+    // Bez --stats / --json wskaznik pomiarow jest pusty i kodek niczego nie mierzy.
+    std::unique_ptr<RunStats> stats;
+    if (args.stats != STATS::NONE) stats = std::make_unique<RunStats>(args.mode == MODE::COMPRESS);
+
+    if (args.batch) {
+        CompressOptions options = options_from(args, table ? &*table : nullptr, stats.get());
+        const bool compress = args.mode == MODE::COMPRESS;
+        std::vector<BatchItem> items = args.list_path.empty()
+            ? BatchProcessor::from_directory(args.input_path, compress, args.output_path)
+            : BatchProcessor::from_list(args.list_path, compress, args.output_path);
+
+        // Bledy pojedynczych plikow sa wypisywane po zakonczeniu, reszta plikow jest przetwarzana dalej.
+        BatchReport report = BatchProcessor::run(items, compress, options, args.threads);
+        for (const auto& error : report.errors) {
+            std::fprintf(stderr, "%s: %s\n", error.first.c_str(), error.second.c_str());
+        }
+        std::fprintf(stderr, "Pliki: %zu, bledy: %zu, dane: %llu -> %llu bajtow.\n", report.files, report.errors.size(),
+                     static_cast<unsigned long long>(report.input_bytes),
+                     static_cast<unsigned long long>(report.output_bytes));
+        if (stats) stats->print(stderr, args.stats == STATS::JSON);
+        return report.errors.empty() ? 0 : 1;
+    }
+
     if (args.mode == MODE::COMPRESS) {
-        std::map<std::byte, uint32_t> byte_frequencies = FileHandler::count_bytes(args.input_path);
-        if (byte_frequencies.empty()) {
-            throw std::runtime_error("Plik jest pusty.");
+        CompressOptions options = options_from(args, table ? &*table : nullptr, stats.get());
+        options.threads = args.threads;
+        CompressionReport report = FileHandler::compress_file(args.input_path, args.output_path, options);
+
+        if (args.max_code_length != 0 && report.unlimited_payload_bits != 0) {
+            double loss = 100.0 * (static_cast<double>(report.payload_bits) / static_cast<double>(report.unlimited_payload_bits) - 1.0);
+            std::fprintf(stderr, "Kody ograniczone do %u bitow (najdluzszy: %u): dane wieksze o %.4f%% niz bez ograniczenia.\n",
+                         args.max_code_length, report.longest_code, loss);
         }
-        std::unique_ptr<HuffmanTree> tree = HuffmanTree::from_frequencies(byte_frequencies);
-        std::unordered_map<std::byte, std::string> codes = tree->build_huffman_codes();
-        FileHandler::write_bits(args.input_path, args.output_path, codes, byte_frequencies);
     }
     else if (args.mode == MODE::DECOMPRESS) {
-        FileHandler::decompress_file(args.input_path, args.output_path);
+        FileHandler::decompress_file(args.input_path, args.output_path, args.threads,
+                                     args.range_begin, args.range_end, args.io_mode, stats.get(),
+                                     table ? &*table : nullptr, args.pipeline);
     }
 
+    if (stats) stats->print(stderr, args.stats == STATS::JSON);
     return 0;
 }
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <streambuf>
+#include <vector>
+
+// Bufor strumienia dopisujacy zapisane bajty na koniec wektora.
+class VectorOutputBuffer : public std::streambuf {
+public:
+    explicit VectorOutputBuffer(std::vector<std::uint8_t>& target) : data(target) {}
+
+protected:
+    int_type overflow(int_type ch) override {
+        if (ch != traits_type::eof()) data.push_back(static_cast<std::uint8_t>(ch));
+        return ch;
+    }
+
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        data.insert(data.end(), reinterpret_cast<const std::uint8_t*>(s), reinterpret_cast<const std::uint8_t*>(s) + n);
+        return n;
+    }
+
+private:
+    std::vector<std::uint8_t>& data;
+};
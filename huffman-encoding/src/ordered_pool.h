@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Prosta pula watkow dla przetwarzania blokow z zapisem w kolejnosci wejscia.
+class OrderedPool {
+public:
+    // Kazdy z `threads` watkow ma wlasny obiekt `Job` (bufory wielokrotnego uzytku):
+    // pobiera zadanie funkcja `read` (pod blokada wejscia, false - koniec zadan),
+    // przetwarza je rownolegle funkcja `process`, a `write` wywoluje sie pod blokada
+    // wyjscia scisle w kolejnosci pobrania. Pierwszy wyjatek przerywa prace i jest
+    // rzucany ponownie w watku wywolujacym.
+    template <typename Job, typename Read, typename Process, typename Write>
+    static void run(unsigned threads, Read read, Process process, Write write) {
+        std::mutex input_mutex;
+        std::mutex output_mutex;
+        std::condition_variable written;
+        std::uint64_t next_job = 0;
+        std::uint64_t next_to_write = 0;
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+
+        auto worker = [&]() {
+            Job job;
+            try {
+                while (!failed) {
+                    std::uint64_t index = 0;
+                    {
+                        std::lock_guard<std::mutex> lock(input_mutex);
+                        if (failed || !read(job)) return;
+                        index = next_job++;
+                    }
+
+                    process(job);
+
+                    std::unique_lock<std::mutex> lock(output_mutex);
+                    written.wait(lock, [&]() { return next_to_write == index || failed; });
+                    if (failed) return;
+                    write(job);
+                    next_to_write++;
+                    written.notify_all();
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(output_mutex);
+                if (!failed) error = std::current_exception();
+                failed = true;
+                written.notify_all();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker);
+        worker();
+        for (std::thread& thread : pool) thread.join();
+        if (error) std::rethrow_exception(error);
+    }
+};
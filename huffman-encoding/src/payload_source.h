@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <stdexcept>
+#include <vector>
+
+// Zrodla danych dla DecodeTable::decode. Zrodlo oddaje dane we fragmentach:
+// next() zwraca kolejny fragment (0 - koniec), last() mowi, czy byl to ostatni
+// fragment, a total_bits() podaje liczbe waznych bitow, gdy last() == true.
+
+// Dane w pamieci o znanej liczbie waznych bitow.
+class MemoryPayloadSource {
+public:
+    MemoryPayloadSource(const std::uint8_t* payload, std::size_t payload_size, std::uint64_t bit_count)
+        : data(payload), size(payload_size), bits(bit_count) {
+        if (bits > static_cast<std::uint64_t>(size) * 8) {
+            throw std::runtime_error("Niepoprawna dlugosc danych");
+        }
+    }
+
+    std::size_t next(const std::uint8_t*& chunk) {
+        chunk = data;
+        std::size_t n = done ? 0 : size;
+        done = true;
+        return n;
+    }
+
+    bool last() const {
+        return done;
+    }
+
+    std::uint64_t total_bits() const {
+        return bits;
+    }
+
+private:
+    const std::uint8_t* data;
+    std::size_t size;
+    std::uint64_t bits;
+    bool done = false;
+};
+
+// Dane czytane ze strumienia fragmentami stalej wielkosci az do konca pliku.
+// Ostatni bajt pliku to liczba bitow dopelnienia, wiec przed oddaniem fragmentu
+// sprawdzamy (peek), czy za nim sa jeszcze dane.
+class StreamPayloadSource {
+public:
+    static constexpr std::size_t DEFAULT_CHUNK = 256 * 1024;
+
+    explicit StreamPayloadSource(std::istream& input, std::size_t chunk_size = DEFAULT_CHUNK)
+        : in(input), buffer(chunk_size == 0 ? 1 : chunk_size) {}
+
+    std::size_t next(const std::uint8_t*& chunk) {
+        chunk = buffer.data();
+        if (finished) return 0;
+
+        in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+        std::size_t n = static_cast<std::size_t>(in.gcount());
+        if (in.bad()) throw std::runtime_error("Wystąpił błąd odczytu pliku.");
+
+        if (n < buffer.size() || in.peek() == std::char_traits<char>::eof()) {
+            finished = true;
+            if (n == 0) {
+                if (bytes == 0) return 0;
+                throw std::runtime_error("Niepoprawny koniec pliku");
+            }
+            std::uint8_t padding = buffer[n - 1];
+            n--;
+            if (padding > 7 || (n == 0 && bytes == 0 && padding != 0)) {
+                throw std::runtime_error("Niepoprawny padding");
+            }
+            bytes += n;
+            bits = bytes * 8 - padding;
+            return n;
+        }
+        bytes += n;
+        return n;
+    }
+
+    bool last() const {
+        return finished;
+    }
+
+    std::uint64_t total_bits() const {
+        return bits;
+    }
+
+private:
+    std::istream& in;
+    std::vector<std::uint8_t> buffer;
+    std::uint64_t bytes = 0;
+    std::uint64_t bits = 0;
+    bool finished = false;
+};
+
+// Dane bloku o znanej liczbie bajtow i bitow dopelnienia, czytane ze strumienia
+// fragmentami. Bufor jest wspolny dla kolejnych blokow (reset()).
+class BlockPayloadSource {
+public:
+    static constexpr std::size_t DEFAULT_CHUNK = 256 * 1024;
+
+    explicit BlockPayloadSource(std::istream& input, std::size_t chunk_size = DEFAULT_CHUNK)
+        : in(input), buffer(chunk_size == 0 ? 1 : chunk_size) {}
+
+    // Ustawia kolejny blok: `payload_bytes` bajtow danych, `padding` bitow dopelnienia.
+    void reset(std::uint64_t payload_bytes, std::uint8_t padding) {
+        if (padding > 7 || (payload_bytes == 0 && padding != 0)) {
+            throw std::runtime_error("Niepoprawny padding");
+        }
+        remaining = payload_bytes;
+        bits = payload_bytes * 8 - padding;
+    }
+
+    std::size_t next(const std::uint8_t*& chunk) {
+        chunk = buffer.data();
+        std::size_t n = remaining < buffer.size() ? static_cast<std::size_t>(remaining) : buffer.size();
+        if (n == 0) return 0;
+        in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(n));
+        if (static_cast<std::size_t>(in.gcount()) != n) {
+            throw std::runtime_error("Niepoprawny koniec pliku");
+        }
+        remaining -= n;
+        return n;
+    }
+
+    bool last() const {
+        return remaining == 0;
+    }
+
+    std::uint64_t total_bits() const {
+        return bits;
+    }
+
+private:
+    std::istream& in;
+    std::vector<std::uint8_t> buffer;
+    std::uint64_t remaining = 0;
+    std::uint64_t bits = 0;
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "run_stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Potok trzech etapow: watek czytajacy, `coders` watkow kodujacych i watek zapisujacy,
+// polaczone pierscieniem `buffers` obiektow Job wielokrotnego uzytku. Odczyt
+// kolejnych blokow nie czeka wiec na kodowanie ani zapis poprzednich - opoznienia
+// dysku lub sieci nakladaja sie na kodowanie. Interfejs jak OrderedPool::run:
+// `read` wypelnia Job (false - koniec danych), `process` go koduje, a `write`
+// zapisuje, scisle w kolejnosci odczytu. `read` i `write` dzialaja kazda w jednym
+// watku. Czas oczekiwania kazdego etapu na pierscien trafia do `stats`.
+class Pipeline {
+public:
+    static constexpr unsigned DEFAULT_BUFFERS = 4;
+    static constexpr unsigned MAX_BUFFERS = 256;
+
+    template <typename Job, typename Read, typename Process, typename Write>
+    static void run(unsigned buffers, unsigned coders, Read read, Process process, Write write, RunStats* stats) {
+        // Przy kilku koderach kazdy potrzebuje bufora, a odczyt i zapis - po jednym wiecej.
+        const std::uint64_t size = std::max(buffers, coders + 2);
+        if (stats) stats->set_pipeline(static_cast<unsigned>(size));
+        std::vector<Job> jobs(static_cast<size_t>(size));
+        std::vector<State> states(static_cast<size_t>(size), State::FREE);
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::uint64_t filled = 0;      // liczba blokow odczytanych
+        std::uint64_t next_to_code = 0;
+        std::uint64_t total = UINT64_MAX;  // liczba blokow po koncu danych
+        bool failed = false;
+        std::exception_ptr error;
+
+        // Czeka na warunek pod blokada i dolicza czas oczekiwania etapu. Zwraca false po bledzie.
+        auto wait = [&](std::unique_lock<std::mutex>& lock, RunStats::Stage stage, auto ready) {
+            if (!ready() && !failed) {
+                auto start = std::chrono::steady_clock::now();
+                changed.wait(lock, [&]() { return ready() || failed; });
+                if (stats) {
+                    stats->add_stall(stage, static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count()));
+                }
+            }
+            return !failed;
+        };
+        auto fail = [&]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!failed) error = std::current_exception();
+            failed = true;
+            changed.notify_all();
+        };
+
+        auto reader = [&]() {
+            try {
+                for (std::uint64_t n = 0;; ++n) {
+                    Job& job = jobs[static_cast<size_t>(n % size)];
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        if (!wait(lock, RunStats::READER, [&]() { return states[n % size] == State::FREE; })) return;
+                    }
+                    bool more = read(job);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (more) {
+                        states[n % size] = State::FILLED;
+                        filled = n + 1;
+                    } else {
+                        total = n;
+                    }
+                    changed.notify_all();
+                    if (!more) return;
+                }
+            } catch (...) {
+                fail();
+            }
+        };
+
+        auto coder = [&]() {
+            try {
+                while (true) {
+                    std::uint64_t n = 0;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        if (!wait(lock, RunStats::CODER, [&]() { return next_to_code < filled || next_to_code >= total; })) {
+                            return;
+                        }
+                        if (next_to_code >= total) return;
+                        n = next_to_code++;
+                    }
+                    process(jobs[static_cast<size_t>(n % size)]);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    states[n % size] = State::CODED;
+                    changed.notify_all();
+                }
+            } catch (...) {
+                fail();
+            }
+        };
+
+        auto writer = [&]() {
+            try {
+                for (std::uint64_t n = 0;; ++n) {
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        if (!wait(lock, RunStats::WRITER, [&]() { return states[n % size] == State::CODED || n >= total; })) {
+                            return;
+                        }
+                        if (n >= total) return;
+                    }
+                    write(jobs[static_cast<size_t>(n % size)]);
+                    std::lock_guard<std::mutex> lock(mutex);
+                    states[n % size] = State::FREE;
+                    changed.notify_all();
+                }
+            } catch (...) {
+                fail();
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.emplace_back(reader);
+        for (unsigned c = 0; c < std::max(coders, 1u); ++c) threads.emplace_back(coder);
+        writer();
+        for (std::thread& thread : threads) thread.join();
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    enum class State { FREE, FILLED, CODED };
+};
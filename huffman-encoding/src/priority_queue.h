@@ -1,47 +1,69 @@
 #pragma once
 
+#include <algorithm>
 #include <vector>
-#include <memory>
 #include <utility>
 #include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+
+// Klucz elementu kolejki: priorytet i tie-break (przy rownych priorytetach wygrywa mniejszy tie).
+using QueueKey = std::pair<std::uint64_t, unsigned int>;
+
+// Domyslny porzadek kluczy: jak std::less<QueueKey>, ale bez skokow warunkowych, ktore
+// dla losowych priorytetow sa zle przewidywane.
+struct QueueKeyLess {
+    bool operator()(const QueueKey& a, const QueueKey& b) const {
+        return (a.first < b.first) | ((a.first == b.first) & (a.second < b.second));
+    }
+};
 
-template <typename T>
+// Kolejka priorytetowa na kopcu d-arnym (`Arity` synow kazdego wezla, domyslnie 4).
+// Kopiec jest plytszy niz binarny, a synowie wezla leza obok siebie w jednej linii
+// pamieci podrecznej. Element to klucz i 32-bitowy indeks danych wywolujacego (np.
+// wezla drzewa albo zadania) - 16 bajtow kopiowanych bez alokacji, wiec kolejka nie
+// przechowuje samych danych. Na szczycie jest klucz najmniejszy wedlug `Compare`
+// (np. std::greater<QueueKey> daje kolejke maksimum).
+template <std::size_t Arity = 4, typename Compare = QueueKeyLess>
 class MinPriorityQueue {
-
-private:
+    static_assert(Arity >= 2, "Kopiec musi miec co najmniej dwoch synow na wezel");
 
 public:
 
     struct Item {
-        unsigned int priority;
+        std::uint64_t priority;
         unsigned int tie;
-        std::unique_ptr<T> value;
+        std::uint32_t index;
+
+        QueueKey key() const {
+            return QueueKey(priority, tie);
+        }
     };
 
-private:
+    MinPriorityQueue() = default;
 
-    std::vector<Item> heap;
+    explicit MinPriorityQueue(Compare compare) : less(std::move(compare)) {}
 
-public:
-    // Dodaje element z priorytetem i wartoscia.
+    // Dodaje element z priorytetem i indeksem.
     void push(Item item) {
-        heap.push_back(std::move(item));
+        heap.push_back(item);
         build_up(heap.size() - 1);
     }
 
     // Usuwa i zwraca element o najmniejszym priorytecie.
-    std::pair<std::pair<unsigned int, unsigned int>, std::unique_ptr<T>> pop() {
-        auto result = std::make_pair(std::make_pair(heap[0].priority, heap[0].tie), std::move(heap[0].value));
-
-        if (heap.size() == 1) {
-            heap.pop_back();
-            return result;
-        }
-
-        heap[0] = std::move(heap.back());
+    Item pop() {
+        if (heap.empty()) throw std::runtime_error("Kolejka jest pusta");
+        const Item first = heap[0];
+        const Item last = heap.back();
         heap.pop_back();
-        build_down(0);
-        return result;
+        if (!heap.empty()) build_down(0, last);
+        return first;
+    }
+
+    // Element o najmniejszym priorytecie bez usuwania (kolejka nie moze byc pusta).
+    const Item& top() const {
+        return heap.front();
     }
 
     // Sprawdza, czy kolejka jest pusta.
@@ -54,26 +76,28 @@ public:
         return heap.size();
     }
 
-    // Zwraca widok danych bez przenoszenia wlasnosci.
-    std::vector<std::pair<std::pair<unsigned int, unsigned int>, const T*>> get_view() const {
-        std::vector<std::pair<std::pair<unsigned int, unsigned int>, const T*>> view_array;
-        view_array.reserve(heap.size());
-        for (const auto& it : heap) {
-            view_array.push_back({{it.priority, it.tie}, it.value.get()});
-        }
-        return view_array;
+    // Rezerwuje miejsce na `count` elementow, zeby push nie alokowal.
+    void reserve(size_t count) {
+        heap.reserve(count);
     }
 
-    static MinPriorityQueue<T> linear_build(std::vector<Item> items) {
-        MinPriorityQueue<T> queue;
-        queue.heap.clear();
-        queue.heap.reserve(items.size());
-        for (auto& item : items) {
-            queue.heap.push_back(std::move(item));
-        }
-        if (!queue.heap.empty()) {
-            for (size_t i = queue.heap.size() / 2; i > 0; i--) {
-                queue.build_down(i);
+    // Usuwa wszystkie elementy; zarezerwowana pamiec zostaje.
+    void clear() {
+        heap.clear();
+    }
+
+    // Zwraca elementy w kolejnosci kopca.
+    const std::vector<Item>& get_view() const {
+        return heap;
+    }
+
+    // Buduje kolejke z `items` w czasie liniowym (przesiewanie od ostatniego rodzica).
+    static MinPriorityQueue linear_build(std::vector<Item> items, Compare compare = Compare()) {
+        MinPriorityQueue queue(std::move(compare));
+        queue.heap = std::move(items);
+        if (queue.heap.size() > 1) {
+            for (size_t i = parent(queue.heap.size() - 1) + 1; i-- > 0;) {
+                queue.build_down(i, queue.heap[i]);
             }
         }
         return queue;
@@ -81,53 +105,55 @@ public:
 
 private:
 
-    // Porownuje elementy po priorytecie i tie-breaku.
-    static bool less(const Item& a, const Item& b) {
-        if (a.priority != b.priority) return a.priority < b.priority;
-        return a.tie < b.tie;
+    std::vector<Item> heap;
+    Compare less;
+
+    bool before(const Item& a, const Item& b) const {
+        return less(a.key(), b.key());
     }
 
-    // Przywraca kopiec, przesuwajac element w gore.
+    // Przywraca kopiec, przesuwajac element w gore. Rodzice schodza w dol na miejsce
+    // elementu, a on sam jest zapisywany raz, na koncu.
     void build_up(size_t index) {
+        const Item item = heap[index];
         while (index > 0) {
             size_t parent_i = parent(index);
-            if (!less(heap[index], heap[parent_i]))
+            if (!before(item, heap[parent_i]))
                 break;
-            std::swap(heap[parent_i], heap[index]);
+            heap[index] = heap[parent_i];
             index = parent_i;
         }
+        heap[index] = item;
     }
 
-    // Przywraca kopiec, przesuwajac element w dol.
-    void build_down(size_t index) {
-        size_t smallest = index;
-        size_t left = left_son(index);
-        size_t right = right_son(index);
-
-        if (left < heap.size() && less(heap[left], heap[smallest]))
-            smallest = left;
-
-        if (right < heap.size() && less(heap[right], heap[smallest]))
-            smallest = right;
-
-        if (smallest != index) {
-            std::swap(heap[index], heap[smallest]);
-            build_down(smallest);
+    // Umieszcza `item` w poddrzewie `index`, przesuwajac najmniejszych synow w gore
+    // (petla, bez rekurencji). Najmniejszy syn jest wybierany bez skokow warunkowych.
+    void build_down(size_t index, const Item item) {
+        const size_t count = heap.size();
+        while (true) {
+            size_t first = first_son(index);
+            if (first >= count)
+                break;
+            size_t last = std::min(first + Arity, count);
+            size_t smallest = first;
+            for (size_t son = first + 1; son < last; ++son) {
+                smallest = before(heap[son], heap[smallest]) ? son : smallest;
+            }
+            if (!before(heap[smallest], item))
+                break;
+            heap[index] = heap[smallest];
+            index = smallest;
         }
+        heap[index] = item;
     }
 
-    // Zwraca indeks lewego dziecka.
-    constexpr size_t left_son(size_t index) const {
-        return 2 * index + 1;
-    }
-
-    // Zwraca indeks prawego dziecka.
-    constexpr size_t right_son(size_t index) const {
-        return 2 * index + 2;
+    // Zwraca indeks pierwszego syna.
+    static constexpr size_t first_son(size_t index) {
+        return Arity * index + 1;
     }
 
     // Zwraca indeks rodzica.
-    constexpr size_t parent(size_t index) const {
-        return (index - 1) / 2;
+    static constexpr size_t parent(size_t index) {
+        return (index - 1) / Arity;
     }
 };
@@ -0,0 +1,294 @@
+#pragma once
+
+#include "byte_counter.h"
+#include "huffman_code.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+// Pomiary jednego uruchomienia (--stats, --json): czas rzeczywisty i czas procesora
+// etapow, rozmiary, entropia i pamiec. Etapy z kilku watkow sa sumowane. Wszystkie
+// pomiary sa opcjonalne - kod kodeka dostaje wskaznik, ktory bez --stats jest pusty.
+class RunStats {
+public:
+    enum Phase { IO, HISTOGRAM, TREE, CODING, PHASE_COUNT };
+    // Etapy potoku (Pipeline): odczyt, kodowanie i zapis.
+    enum Stage { READER, CODER, WRITER, STAGE_COUNT };
+
+    explicit RunStats(bool compress)
+        : compressing(compress), start_wall(std::chrono::steady_clock::now()), start_cpu(process_cpu_ns()) {}
+
+    // Dolicza czas etapu (nanosekundy).
+    void add_time(Phase phase, std::uint64_t wall_ns, std::uint64_t cpu_ns) {
+        wall[phase] += wall_ns;
+        cpu[phase] += cpu_ns;
+    }
+
+    // Dolicza czas, przez ktory etap potoku czekal na pierscien buforow (nanosekundy):
+    // odczyt na wolny bufor, kodowanie na odczytany blok, zapis na zakodowany blok.
+    void add_stall(Stage stage, std::uint64_t wall_ns) {
+        stall[stage] += wall_ns;
+    }
+
+    // Zapamietuje liczbe buforow potoku (0 - bez potoku).
+    void set_pipeline(unsigned buffers) {
+        pipeline_buffers = buffers;
+    }
+
+    // Dolicza rozmiar wejscia i wyjscia przetworzonego pliku.
+    void add_sizes(std::uint64_t input, std::uint64_t output) {
+        std::lock_guard<std::mutex> lock(mutex);
+        input_bytes += input;
+        output_bytes += output;
+    }
+
+    // Dolicza blok: rozmiar danych, rozmiar danych Huffmana w bajtach i w bitach
+    // oraz najdluzszy kod.
+    void add_block(std::uint64_t raw_size, std::uint64_t payload_bytes, std::uint64_t payload_bits,
+                   unsigned longest_code) {
+        std::lock_guard<std::mutex> lock(mutex);
+        raw_bytes += raw_size;
+        payload_total += payload_bytes;
+        payload_bits_total += payload_bits;
+        max_code_length = std::max(max_code_length, longest_code);
+    }
+
+    // Dolicza entropie Shannona bloku o podanym histogramie (suma c * log2(n / c)).
+    void add_entropy(const ByteHistogram& histogram) {
+        add_entropy_bits(ByteCounter::entropy_bits(histogram.data(), histogram.size()));
+    }
+
+    // Dolicza entropie bloku policzona wczesniej (np. entropie warunkowa modelu rzedu 1).
+    void add_entropy_bits(double bits) {
+        std::lock_guard<std::mutex> lock(mutex);
+        entropy_bits += bits;
+        has_entropy = true;
+    }
+
+    // Dolicza blok kodowany histogramem z probki: rozmiar danych w bitach przy kodach
+    // z pelnego histogramu i uzyskany rozmiar (strata probkowania).
+    void add_sampling(std::uint64_t exact_bits, std::uint64_t sampled_bits) {
+        std::lock_guard<std::mutex> lock(mutex);
+        sampling_exact_bits += exact_bits;
+        sampling_bits += sampled_bits;
+        has_sampling = true;
+    }
+
+    // Wypisuje podsumowanie do `out` jako tekst albo jeden obiekt JSON.
+    void print(std::FILE* out, bool json) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        const double total_wall = seconds(static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_wall).count()));
+        const double total_cpu = seconds(process_cpu_ns() - start_cpu);
+        const std::uint64_t huff_bytes = compressing ? output_bytes : input_bytes;
+        const std::uint64_t header_bytes = huff_bytes > payload_total ? huff_bytes - payload_total : 0;
+        const double symbols = raw_bytes == 0 ? 1.0 : static_cast<double>(raw_bytes);
+        const double bits_per_symbol = static_cast<double>(payload_bits_total) / symbols;
+        const double entropy = entropy_bits / symbols;
+        // Stopien kompresji: rozmiar pliku .huff wzgledem danych (dla obu kierunkow).
+        const std::uint64_t plain_bytes = compressing ? input_bytes : output_bytes;
+        const double ratio = plain_bytes == 0 ? 0.0 : static_cast<double>(huff_bytes) / static_cast<double>(plain_bytes);
+        const unsigned long long peak = static_cast<unsigned long long>(peak_memory());
+        const char* names[PHASE_COUNT] = {"io", "histogram", "tree", compressing ? "encode" : "decode"};
+        // Strata probkowania histogramu w procentach danych z pelnego histogramu.
+        const double sampling_loss = sampling_exact_bits == 0 ? 0.0
+            : 100.0 * (static_cast<double>(sampling_bits) / static_cast<double>(sampling_exact_bits) - 1.0);
+        const char* stage_names[STAGE_COUNT] = {"read", compressing ? "encode" : "decode", "write"};
+
+        if (json) {
+            std::fprintf(out, "{\"mode\": \"%s\", \"wall_s\": %.6f, \"cpu_s\": %.6f, \"phases\": {",
+                         compressing ? "compress" : "decompress", total_wall, total_cpu);
+            for (int p = 0; p < PHASE_COUNT; ++p) {
+                std::fprintf(out, "%s\"%s\": {\"wall_s\": %.6f, \"cpu_s\": %.6f}", p == 0 ? "" : ", ", names[p],
+                             seconds(wall[p]), seconds(cpu[p]));
+            }
+            std::fprintf(out, "}, \"input_bytes\": %llu, \"output_bytes\": %llu, \"header_bytes\": %llu, \"ratio\": %.6f, ",
+                         static_cast<unsigned long long>(input_bytes), static_cast<unsigned long long>(output_bytes),
+                         static_cast<unsigned long long>(header_bytes), ratio);
+            if (has_entropy) {
+                std::fprintf(out, "\"entropy_bits_per_symbol\": %.6f, ", entropy);
+            } else {
+                std::fprintf(out, "\"entropy_bits_per_symbol\": null, ");
+            }
+            if (pipeline_buffers != 0) {
+                std::fprintf(out, "\"pipeline\": {\"buffers\": %u, \"stall_s\": {", pipeline_buffers.load());
+                for (int s = 0; s < STAGE_COUNT; ++s) {
+                    std::fprintf(out, "%s\"%s\": %.6f", s == 0 ? "" : ", ", stage_names[s], seconds(stall[s]));
+                }
+                std::fprintf(out, "}}, ");
+            } else {
+                std::fprintf(out, "\"pipeline\": null, ");
+            }
+            if (has_sampling) {
+                std::fprintf(out, "\"sampling_loss_percent\": %.6f, ", sampling_loss);
+            } else {
+                std::fprintf(out, "\"sampling_loss_percent\": null, ");
+            }
+            std::fprintf(out, "\"bits_per_symbol\": %.6f, \"max_code_length\": %u, \"peak_memory_bytes\": %llu}\n",
+                         bits_per_symbol, max_code_length, peak);
+            return;
+        }
+
+        std::fprintf(out, "%s: %.3f s (procesor %.3f s)\n", compressing ? "Kompresja" : "Dekompresja", total_wall, total_cpu);
+        for (int p = 0; p < PHASE_COUNT; ++p) {
+            std::fprintf(out, "  %-10s %10.3f s (procesor %.3f s)\n", names[p], seconds(wall[p]), seconds(cpu[p]));
+        }
+        std::fprintf(out, "  (czasy etapow sa sumowane po watkach)\n");
+        if (pipeline_buffers != 0) {
+            std::fprintf(out, "Przestoje potoku (%u buforow):", pipeline_buffers.load());
+            for (int s = 0; s < STAGE_COUNT; ++s) {
+                std::fprintf(out, "%s %s %.3f s", s == 0 ? "" : ",", stage_names[s], seconds(stall[s]));
+            }
+            std::fprintf(out, "\n");
+        }
+        std::fprintf(out, "Rozmiar: %llu -> %llu bajtow (%.2f%%), naglowki %llu bajtow\n",
+                     static_cast<unsigned long long>(input_bytes), static_cast<unsigned long long>(output_bytes),
+                     100.0 * ratio, static_cast<unsigned long long>(header_bytes));
+        if (has_entropy) {
+            std::fprintf(out, "Bity na symbol: %.4f (entropia %.4f), najdluzszy kod: %u\n", bits_per_symbol, entropy,
+                         max_code_length);
+        } else {
+            std::fprintf(out, "Bity na symbol: %.4f, najdluzszy kod: %u\n", bits_per_symbol, max_code_length);
+        }
+        if (has_sampling) {
+            std::fprintf(out, "Histogram z probki: %+.4f%% danych wzgledem pelnego histogramu\n", sampling_loss);
+        }
+        std::fprintf(out, "Szczytowe zuzycie pamieci: %.1f MiB\n", static_cast<double>(peak) / (1024.0 * 1024.0));
+    }
+
+    // Czas procesora biezacego watku w nanosekundach.
+    static std::uint64_t thread_cpu_ns() {
+#if defined(_WIN32)
+        FILETIME created, exited, kernel, user;
+        if (!GetThreadTimes(GetCurrentThread(), &created, &exited, &kernel, &user)) return 0;
+        return (filetime_ticks(kernel) + filetime_ticks(user)) * 100;
+#else
+        timespec now;
+        if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now) != 0) return 0;
+        return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(now.tv_nsec);
+#endif
+    }
+
+    // Czas procesora calego procesu (wszystkie watki) w nanosekundach.
+    static std::uint64_t process_cpu_ns() {
+#if defined(_WIN32)
+        FILETIME created, exited, kernel, user;
+        if (!GetProcessTimes(GetCurrentProcess(), &created, &exited, &kernel, &user)) return 0;
+        return (filetime_ticks(kernel) + filetime_ticks(user)) * 100;
+#else
+        timespec now;
+        if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now) != 0) return 0;
+        return static_cast<std::uint64_t>(now.tv_sec) * 1000000000ull + static_cast<std::uint64_t>(now.tv_nsec);
+#endif
+    }
+
+    // Szczytowe zuzycie pamieci procesu w bajtach (0, gdy nieznane).
+    static std::uint64_t peak_memory() {
+#if defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS counters;
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+        return counters.PeakWorkingSetSize;
+#else
+        rusage usage;
+        if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+        return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+
+private:
+    const bool compressing;
+    const std::chrono::steady_clock::time_point start_wall;
+    const std::uint64_t start_cpu;
+    std::array<std::atomic<std::uint64_t>, PHASE_COUNT> wall{};
+    std::array<std::atomic<std::uint64_t>, PHASE_COUNT> cpu{};
+    std::array<std::atomic<std::uint64_t>, STAGE_COUNT> stall{};
+    std::atomic<unsigned> pipeline_buffers{0};
+
+    mutable std::mutex mutex;
+    std::uint64_t input_bytes = 0;
+    std::uint64_t output_bytes = 0;
+    std::uint64_t raw_bytes = 0;
+    std::uint64_t payload_total = 0;
+    std::uint64_t payload_bits_total = 0;
+    unsigned max_code_length = 0;
+    double entropy_bits = 0.0;
+    bool has_entropy = false;
+    std::uint64_t sampling_exact_bits = 0;
+    std::uint64_t sampling_bits = 0;
+    bool has_sampling = false;
+
+    static double seconds(std::uint64_t ns) {
+        return static_cast<double>(ns) * 1e-9;
+    }
+
+#if defined(_WIN32)
+    static std::uint64_t filetime_ticks(const FILETIME& time) {
+        return (static_cast<std::uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    }
+#endif
+};
+
+// Mierzy czas etapu od konstrukcji do zniszczenia; przy pustym `stats` nic nie robi.
+// Czas etapow zagniezdzonych w tym samym watku (np. odczyt pliku w trakcie
+// dekodowania) jest odejmowany od etapu zewnetrznego.
+class PhaseTimer {
+public:
+    PhaseTimer(RunStats* run_stats, RunStats::Phase timed_phase) : stats(run_stats), phase(timed_phase) {
+        if (!stats) return;
+        parent = current();
+        current() = this;
+        start_wall = std::chrono::steady_clock::now();
+        start_cpu = RunStats::thread_cpu_ns();
+    }
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+    ~PhaseTimer() {
+        if (!stats) return;
+        std::uint64_t wall = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_wall).count());
+        std::uint64_t cpu = RunStats::thread_cpu_ns() - start_cpu;
+        current() = parent;
+        if (parent) {
+            parent->nested_wall += wall;
+            parent->nested_cpu += cpu;
+        }
+        stats->add_time(phase, wall - std::min(wall, nested_wall), cpu - std::min(cpu, nested_cpu));
+    }
+
+private:
+    RunStats* stats;
+    RunStats::Phase phase;
+    PhaseTimer* parent = nullptr;
+    std::chrono::steady_clock::time_point start_wall;
+    std::uint64_t start_cpu = 0;
+    std::uint64_t nested_wall = 0;
+    std::uint64_t nested_cpu = 0;
+
+    static PhaseTimer*& current() {
+        static thread_local PhaseTimer* timer = nullptr;
+        return timer;
+    }
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include "canonical_codes.h"
+#include "decode_table.h"
+#include "huff_format.h"
+#include "huffman_tree.h"
+#include "length_limited_codes.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// Wspolna tablica kodow wyuczona na probce danych. Kompresja z taka tablica
+// (HuffCodec::compress z SharedTable) nie zlicza bajtow, nie buduje drzewa i nie
+// zapisuje dlugosci kodow - plik wskazuje tablice tylko jej identyfikatorem.
+// Kazdy bajt ma kod, wiec tablica koduje tez dane, ktorych nie bylo w probce.
+// Kody i tablica dekodujaca sa budowane raz, przy tworzeniu obiektu; z jednej
+// tablicy moze korzystac naraz wiele watkow.
+class SharedTable {
+public:
+    // Sygnatura pliku tablicy (inna niz plikow .huff) i wersja jego formatu.
+    static constexpr char MAGIC[4] = {'\x89', 'H', 'U', 'T'};
+    static constexpr int VERSION = 1;
+    // Domyslne ograniczenie dlugosci kodow: bajty rzadkie w probce dostaja kody
+    // najwyzej 15-bitowe, co ogranicza rozrost danych innych niz probka.
+    static constexpr unsigned DEFAULT_MAX_LENGTH = 15;
+
+    // Tablica z dlugosci kodow; kazdy z 256 bajtow musi miec kod.
+    explicit SharedTable(const CodeLengths& code_lengths)
+        : lengths(code_lengths), codes(CanonicalCodes::from_lengths(code_lengths)), decoder(codes) {
+        for (std::uint8_t length : lengths) {
+            if (length == 0) throw std::runtime_error("Wspolna tablica kodow musi miec kod dla kazdego bajtu");
+            longest_code = std::max<unsigned>(longest_code, length);
+        }
+        table_id = hash(lengths);
+    }
+
+    // Buduje tablice z histogramu probki. Do kazdego licznika dodawane jest 1, zeby
+    // kazdy bajt dostal kod; kody sa ograniczone do `max_length` bitow (8-63).
+    static SharedTable train(const ByteHistogram& sample, unsigned max_length = DEFAULT_MAX_LENGTH) {
+        ByteHistogram smoothed = sample;
+        for (std::uint64_t& count : smoothed) count++;
+        CodeLengths lengths = CanonicalCodes::lengths_of(HuffmanTree::from_frequencies(smoothed).build_huffman_codes());
+        if (LengthLimitedCodes::longest(lengths) > max_length) lengths = LengthLimitedCodes::build(smoothed, max_length);
+        return SharedTable(lengths);
+    }
+
+    // Czyta tablice zapisana przez save.
+    static SharedTable load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) throw std::runtime_error("Nie mozna otworzyc pliku tablicy kodow");
+        std::vector<std::uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (file.size() < sizeof(MAGIC) + 1 || !std::equal(MAGIC, MAGIC + sizeof(MAGIC), file.begin(),
+                                                           [](char a, std::uint8_t b) { return static_cast<std::uint8_t>(a) == b; })) {
+            throw std::runtime_error("Niepoprawny plik tablicy kodow");
+        }
+        if (file[sizeof(MAGIC)] != VERSION) throw std::runtime_error("Nieobslugiwana wersja pliku tablicy kodow");
+        const std::uint8_t* p = file.data() + sizeof(MAGIC) + 1;
+        const std::uint8_t* end = file.data() + file.size();
+        CodeLengths lengths = HuffFormat::read_code_lengths(p, end);
+        if (p != end) throw std::runtime_error("Niepoprawny plik tablicy kodow");
+        return SharedTable(lengths);
+    }
+
+    // Zapisuje tablice: sygnatura, wersja i dlugosci kodow (HuffFormat::write_code_lengths).
+    void save(const std::string& path) const {
+        std::vector<std::uint8_t> file(MAGIC, MAGIC + sizeof(MAGIC));
+        file.push_back(static_cast<std::uint8_t>(VERSION));
+        HuffFormat::write_code_lengths(file, lengths);
+        std::ofstream out(path, std::ios::binary);
+        out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        if (!out) throw std::runtime_error("Blad zapisu pliku tablicy kodow");
+    }
+
+    // Identyfikator tablicy zapisywany w skompresowanych plikach (FNV-1a z dlugosci kodow).
+    std::uint32_t id() const {
+        return table_id;
+    }
+
+    const CodeLengths& code_lengths() const {
+        return lengths;
+    }
+
+    const CodeTable& code_table() const {
+        return codes;
+    }
+
+    const DecodeTable& decode_table() const {
+        return decoder;
+    }
+
+    // Najdluzszy kod tablicy.
+    unsigned longest() const {
+        return longest_code;
+    }
+
+private:
+    CodeLengths lengths;
+    CodeTable codes;
+    DecodeTable decoder;
+    unsigned longest_code = 0;
+    std::uint32_t table_id = 0;
+
+    static std::uint32_t hash(const CodeLengths& lengths) {
+        std::uint32_t value = 2166136261u;
+        for (std::uint8_t length : lengths) {
+            value ^= length;
+            value *= 16777619u;
+        }
+        return value;
+    }
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Pula watkow z kradzieza zadan dla wielu niezaleznych zadan roznej wielkosci.
+// Kazdy watek ma wlasna kolejke i bierze zadania z jej poczatku; gdy kolejka
+// sie oprozni, zabiera zadania z konca kolejek innych watkow, wiec zaden watek
+// nie czeka, dopoki gdziekolwiek sa zadania.
+class WorkStealingPool {
+public:
+    // Wykonuje `task(i)` dla i = 0..count-1 na `threads` watkach. Zadania sa
+    // rozdzielane kolejno miedzy watki, wiec podane od najwiekszych daja rowne
+    // obciazenie. Pierwszy wyjatek zatrzymuje pobieranie zadan i jest rzucany
+    // ponownie w watku wywolujacym.
+    template <typename Task>
+    static void run(unsigned threads, std::size_t count, Task task) {
+        if (threads == 0) threads = 1;
+        if (threads > count) threads = count == 0 ? 1 : static_cast<unsigned>(count);
+
+        std::vector<Queue> queues(threads);
+        for (std::size_t i = 0; i < count; ++i) queues[i % threads].tasks.push_back(i);
+
+        std::atomic<bool> failed{false};
+        std::mutex error_mutex;
+        std::exception_ptr error;
+
+        auto worker = [&](unsigned self) {
+            try {
+                std::size_t index = 0;
+                while (!failed && (pop_front(queues[self], index) || steal(queues, self, index))) {
+                    task(index);
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!failed) error = std::current_exception();
+                failed = true;
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned t = 1; t < threads; ++t) pool.emplace_back(worker, t);
+        worker(0);
+        for (std::thread& thread : pool) thread.join();
+        if (error) std::rethrow_exception(error);
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::size_t> tasks;
+    };
+
+    static bool pop_front(Queue& queue, std::size_t& index) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) return false;
+        index = queue.tasks.front();
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    // Zabiera ostatnie zadanie z pierwszej niepustej kolejki innego watku.
+    // Nowe zadania nie dochodza, wiec pusta kolejka u wszystkich oznacza koniec.
+    static bool steal(std::vector<Queue>& queues, unsigned self, std::size_t& index) {
+        for (std::size_t k = 1; k < queues.size(); ++k) {
+            Queue& victim = queues[(self + k) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.tasks.empty()) continue;
+            index = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+        return false;
+    }
+};